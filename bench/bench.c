@@ -0,0 +1,341 @@
+/* the phases of tnine are benchmarked directly, main of tnine is left out */
+#define TNINE_NO_MAIN
+#include "../tnine.c"
+
+#ifdef DEBUG
+#error "the benchmark measures the release build of tnine, build it without DEBUG"
+#endif
+
+/* =========================================
+ *                  Dataset
+ * ========================================= */
+
+#define BENCH_MIN_ENTRIES 1000
+#define BENCH_DEFAULT_MAX_ENTRIES 10000000
+#define BENCH_DEFAULT_RUNS 11
+#define BENCH_DEFAULT_SEED 0x7439u
+
+#if defined(_WIN32)
+#define BENCH_NULL_DEVICE "NUL"
+#else
+#define BENCH_NULL_DEVICE "/dev/null"
+#endif
+
+/**
+ * @brief the hit rates are planted into the numbers as tokens, the token of the i-th rate is "1", '2' + i and zeroes
+ * @note the generated names and numbers contain the keys 2..9 only, so a (substring) query taken from a token matches just the numbers it was planted into
+ * @note the token ends the number, so the '1' a subsequence (match_ex) query begins with is followed by nothing but the token and the query cannot be picked up from the random keys either
+ */
+static const double bench_hit_rates[] = { 0.0, 0.001, 0.01, 0.1, 0.5 };
+#define BENCH_NUM_HIT_RATES (sizeof(bench_hit_rates) / sizeof(bench_hit_rates[0]))
+#define BENCH_TOKEN_SIZE 8
+
+static const String_Index bench_query_sizes[] = { 2, 4, 8 };
+#define BENCH_NUM_QUERY_SIZES (sizeof(bench_query_sizes) / sizeof(bench_query_sizes[0]))
+
+/** @brief xorshift64*, the datasets have to be the same on every platform (rand is not) */
+typedef struct _Bench_Random {
+    uint64_t state;
+} Bench_Random;
+
+static uint64_t bench_random(Bench_Random* random) {
+    random->state ^= random->state >> 12;
+    random->state ^= random->state << 25;
+    random->state ^= random->state >> 27;
+    return random->state * 0x2545F4914F6CDD1Dull;
+}
+
+#define bench_random_below(random, n) ((size_t)(bench_random(random) % (n)))
+#define bench_random_unit(random) ((double)(bench_random(random) >> 11) / 9007199254740992.0)
+
+static void bench_token(size_t rate, OUT char token[BENCH_TOKEN_SIZE]) {
+    memset(token, '0', BENCH_TOKEN_SIZE);
+    token[0] = '1';
+    token[1] = (char)('2' + rate);
+}
+
+/** @brief writes the text registry of @param num_entries random entries into the @param out_source */
+static void bench_generate(size_t num_entries, Bench_Random* random, OUT Arena* out_source) {
+    static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    char line[2 * MAX_STR_LEN];
+    for (size_t e = 0; e < num_entries; e++) {
+        size_t size = 5 + bench_random_below(random, 26);
+        for (size_t i = 0; i < size; i++) {
+            line[i] = letters[bench_random_below(random, sizeof(letters) - 1)];
+        }
+        line[size++] = '\n';
+        size_t number_begin = size;
+        size_t number_size = 6 + bench_random_below(random, 7);
+        for (size_t i = 0; i < number_size; i++) {
+            line[size++] = (char)('2' + bench_random_below(random, 8));
+        }
+        // at most one token per entry, the rates of the tokens do not mix
+        double choice = bench_random_unit(random);
+        for (size_t rate = 1; rate < BENCH_NUM_HIT_RATES; rate++) {
+            if (choice >= bench_hit_rates[rate]) {
+                choice -= bench_hit_rates[rate];
+                continue;
+            }
+            bench_token(rate, OUT &line[number_begin + number_size]);
+            size += BENCH_TOKEN_SIZE;
+            break;
+        }
+        line[size++] = '\n';
+        size_t offset = arena_push(out_source, size);
+        memcpy(out_source->memory + offset, line, size);
+    }
+}
+
+/* =========================================
+ *                  Report
+ * ========================================= */
+
+typedef enum _Bench_Format {
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+} Bench_Format;
+
+/** @brief timings of one phase, the query_size and the hit_rate are only meaningful for the matching phases */
+typedef struct _Bench_Result {
+    size_t num_entries;
+    const char* phase;
+    String_Index query_size;
+    double hit_rate;
+    Phone_Item_Index hits;
+    size_t runs;
+    uint64_t median;
+    uint64_t p99;
+} Bench_Result;
+
+static int _bench_compare_samples(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/** @brief sorts the @param samples and fills the median and the p99 of the @param result */
+static void bench_summarize(uint64_t* samples, size_t runs, OUT Bench_Result* result) {
+    qsort(samples, runs, sizeof(uint64_t), _bench_compare_samples);
+    result->runs = runs;
+    result->median = samples[runs / 2];
+    result->p99 = samples[(runs * 99 + 99) / 100 - 1];
+}
+
+static void bench_report(FILE* report, Bench_Format format, const Bench_Result* result, int first) {
+    double items_per_second = result->median > 0 ? (double)result->num_entries * 1e9 / (double)result->median : 0.0;
+    if (format == BENCH_FORMAT_CSV) {
+        if (first) {
+            fprintf(report, "entries,phase,query_size,hit_rate,hits,runs,median_ns,p99_ns,items_per_second\n");
+        }
+        fprintf(report, "%zu,%s,%d,%g,%lu,%zu,%llu,%llu,%.0f\n", result->num_entries, result->phase, (int)result->query_size, result->hit_rate,
+            (unsigned long)result->hits, result->runs, (unsigned long long)result->median, (unsigned long long)result->p99, items_per_second);
+        return;
+    }
+    fprintf(report, "%s\n  {\"entries\": %zu, \"phase\": \"%s\", \"query_size\": %d, \"hit_rate\": %g, \"hits\": %lu, \"runs\": %zu, \"median_ns\": %llu, \"p99_ns\": %llu, \"items_per_second\": %.0f}",
+        first ? "[" : ",", result->num_entries, result->phase, (int)result->query_size, result->hit_rate, (unsigned long)result->hits, result->runs,
+        (unsigned long long)result->median, (unsigned long long)result->p99, items_per_second);
+}
+
+/* =========================================
+ *                   Phases
+ * ========================================= */
+
+typedef struct _Bench_Args {
+    size_t max_entries;
+    size_t runs;
+    uint64_t seed;
+    Bench_Format format;
+    const char* report_path;
+    const char* kernel;
+} Bench_Args;
+
+typedef struct _Bench {
+    const Bench_Args* args;
+    FILE* report;
+    int first;
+    /** @brief one sample per run */
+    uint64_t* samples;
+} Bench;
+
+static void bench_emit(Bench* bench, Bench_Result* result) {
+    bench_summarize(bench->samples, bench->args->runs, OUT result);
+    bench_report(bench->report, bench->args->format, result, bench->first);
+    bench->first = 0;
+}
+
+/** @brief parses the @param source anew in every run, the @param out_registry keeps the last one */
+static void bench_parse(Bench* bench, const Arena* source, size_t num_entries, OUT Phone_Registry* out_registry) {
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        registry_free(out_registry);
+        arena_borrow(&out_registry->source, source->memory, source->size);
+        uint64_t begin = clock_now();
+        or_exit(parse_file_contents(1, out_registry) == ERROR_NONE, ERROR_INVALID_NUMBER);
+        bench->samples[r] = clock_now() - begin;
+    }
+    Bench_Result result = { .num_entries = num_entries, .phase = "parse_file_contents", .hits = out_registry->num_items };
+    bench_emit(bench, &result);
+
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        arena_free(&out_registry->subsequences.positions);
+        arena_free(&out_registry->subsequences.tables);
+        uint64_t begin = clock_now();
+        subsequence_build(out_registry);
+        bench->samples[r] = clock_now() - begin;
+    }
+    result.phase = "subsequence_build";
+    bench_emit(bench, &result);
+}
+
+/** @brief runs match, match_ex and print_matches (of the match results) for the @param query */
+static void bench_query(Bench* bench, Phone_Registry* registry, const Sized_String* query, double hit_rate) {
+    Phone_Item_Range all = { 0, registry->num_items };
+    Phone_Registry_View matches = { 0 };
+    Bench_Result result = { .num_entries = registry->num_items, .query_size = query->size, .hit_rate = hit_rate };
+
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        view_clear(&matches);
+        uint64_t begin = clock_now();
+        match_ex(*query, registry, all, NULL, OUT &matches);
+        bench->samples[r] = clock_now() - begin;
+    }
+    result.phase = "match_ex";
+    result.hits = matches.num_indexes;
+    bench_emit(bench, &result);
+
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        view_clear(&matches);
+        uint64_t begin = clock_now();
+        match(*query, registry, all, NULL, OUT &matches);
+        bench->samples[r] = clock_now() - begin;
+    }
+    result.phase = "match";
+    result.hits = matches.num_indexes;
+    bench_emit(bench, &result);
+
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        uint64_t begin = clock_now();
+        print_matches(&output, registry, &matches);
+        or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+        bench->samples[r] = clock_now() - begin;
+    }
+    result.phase = "print_matches";
+    bench_emit(bench, &result);
+
+    arena_free(&matches.indexes);
+}
+
+/**
+ * @brief runs automaton_match for all the @param queries at once, the hit rate of the result is the one of all of them together
+ * @note compare with num_queries runs of match, the automaton passes the registry only once
+ */
+static void bench_automaton(Bench* bench, Phone_Registry* registry, const Sized_String* queries, size_t num_queries) {
+    Query_Automaton automaton = { 0 };
+    Bench_Result result = { .num_entries = registry->num_items, .query_size = queries[0].size, .phase = "automaton_match" };
+    for (size_t r = 0; r < bench->args->runs; r++) {
+        automaton_clear(&automaton);
+        for (size_t q = 0; q < num_queries; q++) {
+            automaton_add(&automaton, &queries[q], 0);
+        }
+        uint64_t begin = clock_now();
+        automaton_match(&automaton, registry);
+        bench->samples[r] = clock_now() - begin;
+    }
+    for (size_t q = 0; q < num_queries; q++) {
+        result.hits += automaton_query(&automaton, q)->matches.num_indexes;
+    }
+    result.hit_rate = registry->num_items > 0 ? (double)result.hits / registry->num_items : 0.0;
+    bench_emit(bench, &result);
+    automaton_free(&automaton);
+}
+
+/* =========================================
+ *                    Main
+ * ========================================= */
+
+static int bench_usage(void) {
+    fprintf(stderr, "usage: bench [-n max_entries(>=" stringify_dispatch(BENCH_MIN_ENTRIES) ")] [-r runs] [-s seed] [-f csv|json] [-w report_file] [-k scalar|sse2|avx2]\n");
+    return 1;
+}
+
+static int bench_parse_args(int argc, char** argv, OUT Bench_Args* out_args) {
+    *out_args = (Bench_Args){ .max_entries = BENCH_DEFAULT_MAX_ENTRIES, .runs = BENCH_DEFAULT_RUNS, .seed = BENCH_DEFAULT_SEED };
+    for (int current_arg = 1; current_arg < argc; current_arg++) {
+        const char* arg = argv[current_arg];
+        if (current_arg + 1 >= argc) {
+            return STR_FAIL;
+        }
+        const char* value = argv[++current_arg];
+        if (str_success(strcmp(arg, "-n"))) {
+            out_args->max_entries = strtoull(value, NULL, 10);
+        } else if (str_success(strcmp(arg, "-r"))) {
+            out_args->runs = strtoull(value, NULL, 10);
+        } else if (str_success(strcmp(arg, "-s"))) {
+            out_args->seed = strtoull(value, NULL, 10);
+        } else if (str_success(strcmp(arg, "-f")) && str_success(strcmp(value, "csv"))) {
+            out_args->format = BENCH_FORMAT_CSV;
+        } else if (str_success(strcmp(arg, "-f")) && str_success(strcmp(value, "json"))) {
+            out_args->format = BENCH_FORMAT_JSON;
+        } else if (str_success(strcmp(arg, "-w"))) {
+            out_args->report_path = value;
+        } else if (str_success(strcmp(arg, "-k"))) {
+            out_args->kernel = value;
+        } else {
+            return STR_FAIL;
+        }
+    }
+    if (out_args->max_entries < BENCH_MIN_ENTRIES || out_args->runs == 0 || out_args->seed == 0 || str_fail(kernels_select(out_args->kernel))) {
+        return STR_FAIL;
+    }
+    return STR_SUCCESS;
+}
+
+/**
+ * @brief benchmarks every phase on the registries of 1K, 10K, .. up to max_entries entries (-n)
+ * @note every phase is run (-r) times, the median and the 99th percentile of the runs are reported as CSV or JSON (-f)
+ */
+int main(int argc, char** argv) {
+    Bench_Args args;
+    if (str_fail(bench_parse_args(argc, argv, OUT &args))) {
+        return bench_usage();
+    }
+    Bench bench = { .args = &args, .report = stdout, .first = 1 };
+    if (args.report_path != NULL) {
+        bench.report = fopen(args.report_path, "w");
+        or_exit(bench.report != NULL, ERROR_FILE_OPEN);
+    }
+    FILE* null_device = fopen(BENCH_NULL_DEVICE, "wb");
+    or_exit(null_device != NULL, ERROR_FILE_OPEN);
+    output.fd = fileno(null_device);
+    bench.samples = calloc(args.runs, sizeof(uint64_t));
+    or_exit(bench.samples != NULL, ERROR_FILE_TOO_LARGE);
+
+    Bench_Random random = { args.seed };
+    for (size_t num_entries = BENCH_MIN_ENTRIES; num_entries <= args.max_entries; num_entries *= 10) {
+        Arena source = { 0 };
+        Phone_Registry registry = { 0 };
+        bench_generate(num_entries, &random, OUT &source);
+        bench_parse(&bench, &source, num_entries, OUT &registry);
+        for (size_t s = 0; s < BENCH_NUM_QUERY_SIZES; s++) {
+            Sized_String queries[BENCH_NUM_HIT_RATES];
+            for (size_t rate = 0; rate < BENCH_NUM_HIT_RATES; rate++) {
+                char token[BENCH_TOKEN_SIZE];
+                bench_token(rate, OUT token);
+                queries[rate] = (Sized_String){ .size = bench_query_sizes[s] };
+                memcpy(queries[rate].string, token, queries[rate].size);
+                bench_query(&bench, &registry, &queries[rate], bench_hit_rates[rate]);
+            }
+            bench_automaton(&bench, &registry, queries, BENCH_NUM_HIT_RATES);
+        }
+        registry_free(&registry);
+        arena_free(&source);
+    }
+    if (args.format == BENCH_FORMAT_JSON) {
+        fprintf(bench.report, "\n]\n");
+    }
+
+    free(bench.samples);
+    fclose(null_device);
+    if (bench.report != stdout) {
+        fclose(bench.report);
+    }
+    return ERROR_NONE;
+}
@@ -1,67 +1,381 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <time.h>
-
-// note: this is copied here because we do not have a common header (for now) for the tnine project, once we divide that project
-// accordingly this will be erased and included from the header
-#define MAX_LINE_WIDTH 100
-#define MAX_STR_LEN MAX_LINE_WIDTH + 1
-#define MAX_PHONE_ITEMS 256
-#define MAX_PHONE_ITEMS_FILE_SIZE (MAX_LINE_WIDTH + sizeof('\0')) * MAX_PHONE_ITEMS
-
-#define random_reset() srand(time(NULL))
-#define random() rand()
-
-static char* alloc_string(size_t* string_size) {
-	*string_size = (size_t)random() % MAX_STR_LEN;
-	return calloc(*string_size, sizeof(char));
-}
-
-char* generate_string_name(size_t* string_size) {
-	char* string = alloc_string(string_size);
-	for (size_t i = 0; i < *string_size - 1; i++) {
-		if (random() % 2 == 0) {
-			string[i] = 'a' + random() % 21;
-		}
-		else {
-			string[i] = 'A' + random() % 21;
-		}
-	}
-	string[*string_size - 1] = '\n';
-	return string;
-}
-
-char* generate_string_number(size_t* string_size) {
-	char* string = alloc_string(string_size);
-	for (size_t i = 0; i < *string_size - 1; i++) {
-		string[i] = '0' + random() % 9;
-	}
-	string[*string_size - 1] = '\n';
-	return string;
-}
-
-int main(void) {
-
-	FILE* file = fopen("text_file.txt", "w+");
-	if (file == NULL) {
-		perror("File could not be opened: ");
-		return 1;
-	}
-	char* name = NULL, *number = NULL;
-	size_t name_size = 0, number_size = 0;
-	random_reset();
-	for (size_t i = 0; i < random() % 100; i++) {
-		// note: we do not really care about the performance of this...
-		name = generate_string_name(&name_size);
-		number = generate_string_number(&number_size);
-		fwrite(name, name_size, 1, file);
-		fwrite(number, number_size, 1, file);
-		printf("%s", name);
-		printf("%s", number);
-		free(name); name = NULL;
-		free(number); number = NULL;
-	}
-	fclose(file);
-
-	return 0;
+/* the generator writes exactly what tnine parses, the limits and the T9 keys are taken from tnine itself (its main is left out) */
+#define TNINE_NO_MAIN
+#include "../tnine.c"
+
+#include <math.h>
+
+/* =========================================
+ *                  Random
+ * ========================================= */
+
+#define GENERATOR_DEFAULT_CONTACTS 1000
+#define GENERATOR_DEFAULT_SEED 0x7439u
+#define GENERATOR_DEFAULT_SKEW 1.0
+
+/** @brief xorshift64*, the same seed has to give the same registry on every platform (rand is not) */
+typedef struct _Generator_Random {
+    uint64_t state;
+} Generator_Random;
+
+static uint64_t generator_random(Generator_Random* random) {
+    random->state ^= random->state >> 12;
+    random->state ^= random->state << 25;
+    random->state ^= random->state >> 27;
+    return random->state * 0x2545F4914F6CDD1Dull;
+}
+
+#define generator_random_below(random, n) ((size_t)(generator_random(random) % (n)))
+#define generator_random_unit(random) ((double)(generator_random(random) >> 11) / 9007199254740992.0)
+/** @brief triangular distribution over min..min + 2 * (spread - 1), the lengths of the words cluster around the middle of it */
+#define generator_random_length(random, min, spread) ((min) + generator_random_below(random, spread) + generator_random_below(random, spread))
+
+/* =========================================
+ *                  Names
+ * ========================================= */
+
+/** @brief number of distinct first names and of distinct last names, the names of the contacts are drawn from these */
+#define GENERATOR_VOCABULARY_SIZE 4096
+#define GENERATOR_WORD_CAPACITY 16
+
+/** @brief relative frequencies of the letters in English words (per mille), the words are spelled with all of the T9 keys */
+static const struct {
+    char letter;
+    unsigned weight;
+} generator_letter_weights[] = {
+    { 'e', 127 }, { 't', 91 }, { 'a', 82 }, { 'o', 75 }, { 'i', 70 }, { 'n', 67 }, { 's', 63 }, { 'h', 61 }, { 'r', 60 },
+    { 'd', 43 }, { 'l', 40 }, { 'c', 28 }, { 'u', 28 }, { 'm', 24 }, { 'w', 24 }, { 'f', 22 }, { 'g', 20 }, { 'y', 20 },
+    { 'p', 19 }, { 'b', 15 }, { 'v', 10 }, { 'k', 8 }, { 'j', 2 }, { 'x', 2 }, { 'q', 1 }, { 'z', 1 },
+};
+#define GENERATOR_NUM_LETTERS (sizeof(generator_letter_weights) / sizeof(generator_letter_weights[0]))
+
+typedef struct _Generator_Word {
+    uint8_t size;
+    char letters[GENERATOR_WORD_CAPACITY];
+} Generator_Word;
+
+/** @brief the words every name is made of, drawn with the Zipf distribution of the skew (-z) */
+typedef struct _Generator_Vocabulary {
+    /** @brief every letter repeated as many times as its weight, a uniform draw from it follows the frequencies */
+    char letters[1024];
+    size_t num_letters;
+    Generator_Word first_names[GENERATOR_VOCABULARY_SIZE];
+    Generator_Word last_names[GENERATOR_VOCABULARY_SIZE];
+    /** @brief cumulative probabilities of the ranks of the words (the same ones for the first and the last names) */
+    double ranks[GENERATOR_VOCABULARY_SIZE];
+} Generator_Vocabulary;
+
+static void _generator_word(const Generator_Vocabulary* vocabulary, Generator_Random* random, size_t size, OUT Generator_Word* out_word) {
+    out_word->size = (uint8_t)size;
+    for (size_t i = 0; i < size; i++) {
+        out_word->letters[i] = vocabulary->letters[generator_random_below(random, vocabulary->num_letters)];
+    }
+    out_word->letters[0] = (char)(out_word->letters[0] - 'a' + 'A');
+}
+
+/** @brief spells all of the words of the @param out_vocabulary, the ranks follow 1 / rank^@param skew (0 draws every word equally often) */
+static void generator_vocabulary(Generator_Random* random, double skew, OUT Generator_Vocabulary* out_vocabulary) {
+    out_vocabulary->num_letters = 0;
+    for (size_t l = 0; l < GENERATOR_NUM_LETTERS; l++) {
+        for (unsigned w = 0; w < generator_letter_weights[l].weight; w++) {
+            out_vocabulary->letters[out_vocabulary->num_letters++] = generator_letter_weights[l].letter;
+        }
+    }
+    for (size_t w = 0; w < GENERATOR_VOCABULARY_SIZE; w++) {
+        // first names are 3..11 letters long (mostly 6 or 7), last names 4..14 (mostly 8 or 9)
+        _generator_word(out_vocabulary, random, generator_random_length(random, 3, 5), OUT &out_vocabulary->first_names[w]);
+        _generator_word(out_vocabulary, random, generator_random_length(random, 4, 6), OUT &out_vocabulary->last_names[w]);
+    }
+    double total = 0.0;
+    for (size_t w = 0; w < GENERATOR_VOCABULARY_SIZE; w++) {
+        total += 1.0 / pow((double)(w + 1), skew);
+        out_vocabulary->ranks[w] = total;
+    }
+    for (size_t w = 0; w < GENERATOR_VOCABULARY_SIZE; w++) {
+        out_vocabulary->ranks[w] /= total;
+    }
+}
+
+/** @brief draws a word rank with the distribution of the @param vocabulary */
+static size_t _generator_rank(const Generator_Vocabulary* vocabulary, Generator_Random* random) {
+    double unit = generator_random_unit(random);
+    size_t low = 0, high = GENERATOR_VOCABULARY_SIZE - 1;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (vocabulary->ranks[middle] < unit) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/* =========================================
+ *                 Contacts
+ * ========================================= */
+
+/** @brief a contact is put into one of the previous few of the same kind (hit or miss) if it is a duplicate (-d) */
+#define GENERATOR_RING_SIZE 1024
+/** @brief a miss is generated again this many times at most while it still contains the query by chance */
+#define GENERATOR_MAX_ATTEMPTS 1000
+
+/** @brief the fields are padded, so that the kernels can look for the query in them */
+typedef struct _Generator_Contact {
+    String_Index name_size;
+    String_Index number_size;
+    char name[MAX_STR_LEN + KERNEL_PADDING];
+    char number[MAX_STR_LEN + KERNEL_PADDING];
+} Generator_Contact;
+
+typedef struct _Generator_Ring {
+    size_t size;
+    size_t next;
+    Generator_Contact contacts[GENERATOR_RING_SIZE];
+} Generator_Ring;
+
+inline static void _generator_append(OUT char* field, OUT String_Index* size, const char* data, size_t data_size) {
+    memcpy(field + *size, data, data_size);
+    *size = (String_Index)(*size + data_size);
+}
+
+/** @brief "First Last" mostly, some contacts have the first name or a double-barrelled last name only */
+static void _generator_name(const Generator_Vocabulary* vocabulary, Generator_Random* random, OUT Generator_Contact* contact) {
+    const Generator_Word* first = &vocabulary->first_names[_generator_rank(vocabulary, random)];
+    const Generator_Word* last = &vocabulary->last_names[_generator_rank(vocabulary, random)];
+    size_t kind = generator_random_below(random, 100);
+    contact->name_size = 0;
+    _generator_append(contact->name, &contact->name_size, first->letters, first->size);
+    if (kind < 10) {
+        return;
+    }
+    _generator_append(contact->name, &contact->name_size, " ", 1);
+    _generator_append(contact->name, &contact->name_size, last->letters, last->size);
+    if (kind < 95) {
+        return;
+    }
+    const Generator_Word* second = &vocabulary->last_names[_generator_rank(vocabulary, random)];
+    _generator_append(contact->name, &contact->name_size, "-", 1);
+    _generator_append(contact->name, &contact->name_size, second->letters, second->size);
+}
+
+/** @brief national numbers (0 and 9 digits) mostly, international ones (+, country code and 9 or 10 digits) and short service numbers */
+static void _generator_number(Generator_Random* random, OUT Generator_Contact* contact) {
+    size_t kind = generator_random_below(random, 100);
+    size_t num_digits;
+    contact->number_size = 0;
+    if (kind < 65) {
+        contact->number[contact->number_size++] = '0';
+        num_digits = 9;
+    } else if (kind < 95) {
+        contact->number[contact->number_size++] = '+';
+        contact->number[contact->number_size++] = (char)('1' + generator_random_below(random, 9));
+        num_digits = generator_random_below(random, 3) + 9;
+    } else {
+        num_digits = generator_random_length(random, 3, 2);
+    }
+    for (size_t i = 0; i < num_digits; i++) {
+        contact->number[contact->number_size++] = (char)('0' + generator_random_below(random, 10));
+    }
+}
+
+/** @brief how the contacts are generated (see generator_usage), the hits of the query are spread evenly over the registry */
+typedef struct _Generator_Args {
+    size_t num_contacts;
+    uint64_t seed;
+    const char* output_path;
+    /** @brief the keyboard input whose hits are planted (-q), nothing is planted if it is empty */
+    Sized_String query;
+    double hit_rate;
+    double duplicate_rate;
+    double skew;
+} Generator_Args;
+
+/** @brief letters typed with the key '0' + k (the digits themselves for the keys without letters) */
+typedef struct _Generator_Keys {
+    char letters[T9_NUM_KEYS][4];
+    size_t num_letters[T9_NUM_KEYS];
+} Generator_Keys;
+
+static void generator_keys(OUT Generator_Keys* out_keys) {
+    memset(out_keys, 0, sizeof(Generator_Keys));
+    for (int c = 'a'; c <= 'z'; c++) {
+        size_t key = (size_t)(t9_keys[c] - '0');
+        out_keys->letters[key][out_keys->num_letters[key]++] = (char)c;
+    }
+    for (size_t key = 0; key < T9_NUM_KEYS; key++) {
+        if (out_keys->num_letters[key] == 0) {
+            out_keys->letters[key][out_keys->num_letters[key]++] = (char)('0' + key);
+        }
+    }
+}
+
+/**
+ * @brief puts the query into the number or (spelled with letters of its keys) into the name of the @param contact at random
+ * @note a query with '+' can be typed only in numbers, the field is cut so that the query fits into MAX_LINE_WIDTH
+ */
+static void _generator_plant(const Generator_Args* args, const Generator_Keys* keys, Generator_Random* random, Generator_Contact* contact) {
+    const Sized_String* query = &args->query;
+    int into_name = memchr(query->string, '+', query->size) == NULL && generator_random_below(random, 2) == 0;
+    char* field = into_name ? contact->name : contact->number;
+    String_Index* size = into_name ? &contact->name_size : &contact->number_size;
+    if (*size + query->size > MAX_LINE_WIDTH) {
+        *size = (String_Index)(MAX_LINE_WIDTH - query->size);
+    }
+    size_t at = generator_random_below(random, (size_t)*size + 1);
+    memmove(field + at + query->size, field + at, *size - at);
+    for (String_Index k = 0; k < query->size; k++) {
+        size_t key = (size_t)(query->string[k] - '0');
+        field[at + k] = into_name ? keys->letters[key][generator_random_below(random, keys->num_letters[key])] : query->string[k];
+    }
+    *size = (String_Index)(*size + query->size);
+}
+
+/** @brief whether tnine would match the @param contact for the @param t9_query (the folded query), see match */
+static int _generator_matches(const Generator_Args* args, const Sized_String* t9_query, Generator_Contact* contact) {
+    char encoded[MAX_STR_LEN + KERNEL_PADDING] = { 0 };
+    t9_encode_number(contact->number, contact->number_size, OUT encoded);
+    if (kernels.find(t9_query->string, t9_query->size, encoded, contact->number_size) != STRING_NOT_FOUND) {
+        return 1;
+    }
+    t9_encode_name(contact->name, contact->name_size, OUT encoded);
+    return kernels.find(args->query.string, args->query.size, encoded, contact->name_size) != STRING_NOT_FOUND;
+}
+
+inline static void _generator_write(const Generator_Contact* contact) {
+    char* line = output_reserve(&output, (size_t)contact->name_size + contact->number_size + 2);
+    memcpy(line, contact->name, contact->name_size);
+    line += contact->name_size;
+    *line++ = '\n';
+    memcpy(line, contact->number, contact->number_size);
+    line[contact->number_size] = '\n';
+}
+
+/**
+ * @brief writes the whole registry into the output
+ * @return 0 on success and 1 if the misses of the query cannot be generated (it is contained in nearly every random contact)
+ */
+static int generator_run(const Generator_Args* args) {
+    Generator_Random random = { args->seed };
+    static Generator_Vocabulary vocabulary;
+    generator_vocabulary(&random, args->skew, OUT &vocabulary);
+    Generator_Keys keys;
+    generator_keys(OUT &keys);
+    Sized_String t9_query = t9_fold_phone(&args->query);
+    // the rings of the misses (0) and of the hits (1)
+    static Generator_Ring rings[2];
+    Generator_Contact contact;
+    for (size_t c = 0; c < args->num_contacts; c++) {
+        int hit = args->query.size > 0 && (size_t)((double)(c + 1) * args->hit_rate) > (size_t)((double)c * args->hit_rate);
+        Generator_Ring* ring = &rings[hit];
+        if (ring->size > 0 && generator_random_unit(&random) < args->duplicate_rate) {
+            _generator_write(&ring->contacts[generator_random_below(&random, ring->size)]);
+            continue;
+        }
+        int attempts = 0;
+        do {
+            if (attempts++ == GENERATOR_MAX_ATTEMPTS) {
+                return STR_FAIL;
+            }
+            _generator_name(&vocabulary, &random, OUT &contact);
+            _generator_number(&random, OUT &contact);
+            if (hit) {
+                _generator_plant(args, &keys, &random, &contact);
+            }
+        } while (!hit && args->query.size > 0 && _generator_matches(args, &t9_query, &contact));
+        _generator_write(&contact);
+        ring->contacts[ring->next] = contact;
+        ring->next = (ring->next + 1) % GENERATOR_RING_SIZE;
+        ring->size += ring->size < GENERATOR_RING_SIZE;
+    }
+    return STR_SUCCESS;
+}
+
+/* =========================================
+ *                   Main
+ * ========================================= */
+
+static int generator_usage(void) {
+    fprintf(stderr, "usage: generator [-n num_contacts] [-s seed] [-o output_file] [-q query -r hit_rate] [-d duplicate_rate] [-z skew]\n");
+    return 1;
+}
+
+/** @brief a rate (-r, -d) in 0..1 */
+static int _generator_rate(const char* value, OUT double* out_rate) {
+    char* end;
+    *out_rate = strtod(value, &end);
+    return *end == '\0' && *out_rate >= 0.0 && *out_rate <= 1.0 ? STR_SUCCESS : STR_FAIL;
+}
+
+static int generator_parse_args(int argc, char** argv, OUT Generator_Args* out_args) {
+    *out_args = (Generator_Args){ .num_contacts = GENERATOR_DEFAULT_CONTACTS, .seed = GENERATOR_DEFAULT_SEED, .skew = GENERATOR_DEFAULT_SKEW };
+    int has_rate = 0;
+    for (int current_arg = 1; current_arg < argc; current_arg++) {
+        const char* arg = argv[current_arg];
+        if (current_arg + 1 >= argc) {
+            return STR_FAIL;
+        }
+        const char* value = argv[++current_arg];
+        if (str_success(strcmp(arg, "-n"))) {
+            out_args->num_contacts = strtoull(value, NULL, 10);
+        } else if (str_success(strcmp(arg, "-s"))) {
+            out_args->seed = strtoull(value, NULL, 10);
+        } else if (str_success(strcmp(arg, "-o"))) {
+            out_args->output_path = value;
+        } else if (str_success(strcmp(arg, "-q"))) {
+            if (str_fail(string_is_number((String_View)value)) || strlen(value) > MAX_LINE_WIDTH) {
+                return STR_FAIL;
+            }
+            out_args->query.size = (String_Index)strlen(value);
+            memcpy(out_args->query.string, value, out_args->query.size);
+        } else if (str_success(strcmp(arg, "-r"))) {
+            if (str_fail(_generator_rate(value, OUT &out_args->hit_rate))) {
+                return STR_FAIL;
+            }
+            has_rate = 1;
+        } else if (str_success(strcmp(arg, "-d"))) {
+            if (str_fail(_generator_rate(value, OUT &out_args->duplicate_rate))) {
+                return STR_FAIL;
+            }
+        } else if (str_success(strcmp(arg, "-z"))) {
+            char* end;
+            out_args->skew = strtod(value, &end);
+            if (*end != '\0' || out_args->skew < 0.0) {
+                return STR_FAIL;
+            }
+        } else {
+            return STR_FAIL;
+        }
+    }
+    // the hit rate belongs to the query (and the query is matched by the generated misses only with a rate of 1)
+    if (out_args->seed == 0 || has_rate != (out_args->query.size > 0) || str_fail(kernels_select(NULL))) {
+        return STR_FAIL;
+    }
+    return STR_SUCCESS;
+}
+
+/**
+ * @brief writes a text registry of (-n) random contacts to stdout or into the (-o) file, the same seed (-s) gives the same registry
+ * @note the first and the last names are drawn from a vocabulary with Zipf skew (-z), a part of the contacts (-d) repeats one of the previous ones
+ * @note exactly the given part (-r) of the contacts contains the query (-q), none of the others does (in the number or in the T9 encoded name, same as tnine matches)
+ */
+int main(int argc, char** argv) {
+    Generator_Args args;
+    if (str_fail(generator_parse_args(argc, argv, OUT &args))) {
+        return generator_usage();
+    }
+    FILE* file = NULL;
+    if (args.output_path != NULL) {
+        file = fopen(args.output_path, "wb");
+        or_exit(file != NULL, ERROR_FILE_OPEN);
+        output.fd = fileno(file);
+    }
+    if (str_fail(generator_run(&args))) {
+        fprintf(stderr, "the query is contained in nearly every random contact, it cannot be missed by the rest of them (raise the hit rate or make the query longer)\n");
+        return 1;
+    }
+    or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+    if (file != NULL) {
+        or_exit(fclose(file) == 0, ERROR_FILE_WRITE);
+    }
+    return 0;
 }
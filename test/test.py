@@ -1,7 +1,11 @@
+import json
 import random
 import string
 import subprocess
 import os
+import signal
+import socket
+import threading
 from enum import Enum
 from os import path
 from dataclasses import dataclass
@@ -12,6 +16,10 @@ from time import time
 NUM_PAIRS_MAX = 100
 NAME_LENGTH_MAX = 100
 NUMBER_LENGTH_MAX = 100
+# more than twice SCAN_MIN_CHUNK_ITEMS (tnine.c), below it -j scans with a single thread
+PARALLEL_PAIRS_MIN = 2 * 4096 + 1
+# PARSE_MIN_CHUNK_SIZE (tnine.c), -j splits the text registry into chunks of at least this many bytes
+PARSE_CHUNK_SIZE_MIN = 1024 * 1024
 
 def random_string(length):
     return ''.join(random.choices(string.ascii_letters, k=length))
@@ -29,6 +37,87 @@ def generate(filename: str) -> list[str]:
 
 Error = int
 
+# the reference the differential modes are checked against
+T9_KEYS = {letter: key for key, letters in {'2': "abc", '3': "def", '4': "ghi", '5': "jkl", '6': "mno", '7': "pqrs", '8': "tuv", '9': "wxyz"}.items() for letter in letters + letters.upper()}
+
+def t9_name(name: str) -> str:
+    return ''.join('0' if c in "0+" else '1' if c == '1' else T9_KEYS.get(c, '_') for c in name)
+
+def fold(number: str) -> str:
+    return number.replace('+', '0')
+
+def is_subsequence(query: str, field: str) -> bool:
+    it = iter(field)
+    return all(c in it for c in query)
+
+def pairs_of(content: list[str]) -> list[tuple[str, str]]:
+    return list(zip(content[::2], content[1::2]))
+
+def write_registry(filename: str, pairs: list[tuple[str, str]]) -> None:
+    with open(filename, 'w') as f:
+        f.writelines(f"{name}\n{number}\n" for name, number in pairs)
+
+def reference_matches(pairs: list[tuple[str, str]], query: str | None, extended_search: bool) -> list[int]:
+    """indexes of the matching pairs in the registry order, no query lists all of them"""
+    if query is None:
+        return list(range(len(pairs)))
+    if extended_search:
+        return [i for i, (name, number) in enumerate(pairs) if is_subsequence(fold(query), fold(number)) or is_subsequence(query, t9_name(name))]
+    return [i for i, (name, number) in enumerate(pairs) if query != '' and (fold(query) in fold(number) or query in t9_name(name))]
+
+def reference_ranks(pairs: list[tuple[str, str]], query: str | None, extended_search: bool) -> list[tuple[int, ...]]:
+    """(field, offset, index) of every match, the number before the name, then the earlier occurrence (of the first key for -s), then the registry order"""
+    ranks: list[tuple[int, ...]] = []
+    for i, (name, number) in enumerate(pairs):
+        if query is None:
+            ranks.append((0, 0, i))
+            continue
+        t9_number, t9 = fold(number), t9_name(name)
+        if extended_search:
+            if is_subsequence(fold(query), t9_number):
+                ranks.append((0, t9_number.index(fold(query)[0]), i))
+            elif is_subsequence(query, t9):
+                ranks.append((1, t9.index(query[0]), i))
+        elif fold(query) in t9_number:
+            ranks.append((0, t9_number.index(fold(query)), i))
+        elif query in t9:
+            ranks.append((1, t9.index(query), i))
+    return sorted(ranks)
+
+def edit_distance(query: str, field: str) -> tuple[int, int]:
+    """the fewest typos the query occurs with anywhere in the field and the end of the first such occurrence"""
+    column = list(range(len(query) + 1))
+    best, end = len(query), 0
+    for j, c in enumerate(field):
+        next_column = [0] * (len(query) + 1)
+        for i in range(1, len(query) + 1):
+            next_column[i] = min(column[i] + 1, next_column[i - 1] + 1, column[i - 1] + (query[i - 1] != c))
+        column = next_column
+        if column[-1] < best:
+            best, end = column[-1], j
+    return best, end
+
+def reference_fuzzy(pairs: list[tuple[str, str]], query: str, max_errors: int) -> list[tuple[int, ...]]:
+    """(typos, field, end, index) of every match within max_errors (-e), the fields too short to hold the query within them are skipped"""
+    ranks: list[tuple[int, ...]] = []
+    for i, (name, number) in enumerate(pairs):
+        distance, end, field = len(query) + max_errors + 1, 0, 0
+        if len(number) + max_errors >= len(query):
+            distance, end = edit_distance(fold(query), fold(number))
+        if distance > 0 and '+' not in query and len(name) + max_errors >= len(query):
+            name_distance, name_end = edit_distance(query, t9_name(name))
+            if name_distance < distance:
+                distance, end, field = name_distance, name_end, 1
+        if distance <= max_errors:
+            ranks.append((distance, field, end, i))
+    return sorted(ranks)
+
+def format_matches(pairs: list[tuple[str, str]], indexes: list[int]) -> str:
+    return ''.join(f"{pairs[i][0]}, {pairs[i][1]}\n" for i in indexes) or "Not found\n"
+
+def random_query() -> str | None:
+    return None if random.random() < 0.05 else ''.join(random.choices(string.digits + '+', k=random.randint(1, 4)))
+
 def run_program(_, command) -> tuple[Error, str]:
     with open('output.txt', 'w') as outfile:
         print(f"Run program args: {command}")
@@ -138,15 +227,345 @@ class TimedTest(Test):
         TEST_TIMES.append(TimedTestStamp(time_taken=(t2 - t1) * 1000, num_contacts=len(self.generated_file_content) / 2))
         print(f"Test [command={self.commands}]\x1b[33m {(t2 - t1) * 1000}ms\x1b[0m")
 
+KERNELS = ["scalar", "sse2", "avx2"]
+
+class DifferentialMode(Enum):
+    KERNELS = 0
+    EDITS = 1
+    SESSION = 2
+    RANKED = 3
+    BATCH = 4
+    FUZZY = 5
+    STREAM = 6
+    SHARDS = 7
+    SERVER = 8
+    PARALLEL = 9
+    PARSE = 10
+
+class DifferentialTest(Test):
+    """
+    runs the same search with every matching kernel (-k), the outputs have to be identical to the scalar (reference) one,
+    the other modes compare the output of the program with the one of the reference above
+    """
+    def __init__(self, footprint: TestFootprint, output_file: str, program_path: str, mode: DifferentialMode = DifferentialMode.KERNELS):
+        self.footprint = footprint
+        self.mode = mode
+        self.commands = [program_path]
+        self.generated_file = output_file
+        self.generated_file_content = generate(output_file)
+        self.pairs = pairs_of(self.generated_file_content)
+        # the counters of the stats (-m) the run has to report, if the mode checks them
+        self.expected_stats: dict[str, int] | None = None
+        if self.footprint.extended_search:
+            self.commands.append("-s")
+        if self.footprint.t9_number_enabled:
+            self.commands.append(''.join(random.choices(string.digits + '+', k=random.randint(1, 4))))
+        self.commands.append(f"<{self.generated_file}")
+
+    def run_test(self) -> None:
+        if self.mode in (DifferentialMode.SERVER, DifferentialMode.PARSE):
+            getattr(self, f"_DifferentialTest__run_{self.mode.name.lower()}")()
+            return
+        if self.mode != DifferentialMode.KERNELS:
+            self.__run_reference()
+            return
+        outputs: list[str] = []
+        for kernel in KERNELS:
+            program_return = run_program(self.generated_file, [self.commands[0], "-k", kernel] + self.commands[1:])
+            if program_return[0] != 0:
+                # the kernel is not supported by this CPU
+                print(f"Kernel {kernel} skipped: {program_return[1]}")
+                continue
+            with open('output.txt', 'r') as f:
+                outputs.append(f.read())
+        if all(output == outputs[0] for output in outputs):
+            print(f"Test [command={self.commands}]\x1b[32m passed\x1b[0m\n")
+        else:
+            print(f"For arguments {self.commands}\n The kernels gave \x1b[31mdifferent\x1b[0m outputs\n")
+
+    def __run_reference(self) -> None:
+        commands, expected = getattr(self, f"_DifferentialTest__{self.mode.name.lower()}")()
+        # one command line, a list is not split into the arguments by the shell on every platform
+        program_return = run_program(self.generated_file, ' '.join(commands))
+        with open('output.txt', 'r') as f:
+            output = f.read()
+        stats = json.loads(program_return[1].splitlines()[-1]) if self.expected_stats is not None and program_return[1] else {}
+        stats_match = self.expected_stats is None or all(stats.get(key) == value for key, value in self.expected_stats.items())
+        if program_return[0] == 0 and output == expected and stats_match:
+            print(f"Test [mode={self.mode.name}; command={commands}]\x1b[32m passed\x1b[0m\n")
+        else:
+            print(f"For arguments {commands} (mode={self.mode.name})\n The output \x1b[31mdiffers\x1b[0m from the reference (returned {program_return[0]}: {program_return[1]})\n")
+
+    def __edits(self) -> tuple[list[str], str]:
+        """!add, !set, !del and !compact mixed with queries in a batch (-b), every other registry is compiled (-c) first, its arenas are mapped read only"""
+        registry = self.generated_file
+        if random.random() < 0.5:
+            registry = self.generated_file + ".img"
+            subprocess.run([self.commands[0], "-c", registry, "-f", self.generated_file], check=True)
+        # [id, name, number, alive] in the registry order
+        items = [[i, name, number, True] for i, (name, number) in enumerate(self.pairs)]
+        next_id = len(items)
+        lines: list[str] = []
+        expected = ""
+        for _ in range(random.randint(1, 40)):
+            kind = random.random()
+            alive = [item for item in items if item[3]]
+            name = random_string(random.randrange(1, 20))
+            number = ''.join(random.choices(string.digits + '+', k=random.randrange(1, 12)))
+            if kind < 0.2:
+                lines.append(f"!add {number} {name}")
+                items.append([next_id, name, number, True])
+                expected += f"OK {next_id}\n\n"
+                next_id += 1
+            elif kind < 0.35 and alive:
+                item = random.choice(alive)
+                lines.append(f"!set {item[0]} {number} {name}")
+                item[1], item[2] = name, number
+                expected += f"OK {item[0]}\n\n"
+            elif kind < 0.5 and alive:
+                item = random.choice(alive)
+                lines.append(f"!del {item[0]}")
+                item[3] = False
+                expected += f"OK {item[0]}\n\n"
+            elif kind < 0.55:
+                lines.append("!compact")
+                items = alive
+                expected += f"OK {len(items)}\n\n"
+            else:
+                extended_search = random.random() < 0.5
+                query = random_query()
+                lines.append(("-s " if extended_search else "") + (query or ""))
+                pairs = [(item[1], item[2]) for item in alive]
+                expected += format_matches(pairs, reference_matches(pairs, query, extended_search)) + "\n"
+        with open(self.generated_file + ".edits", 'w') as f:
+            f.writelines(line + "\n" for line in lines)
+        return [self.commands[0], "-f", registry, "-b", self.generated_file + ".edits"], expected
+
+    def __session(self) -> tuple[list[str], str]:
+        """keystrokes typed in a session (-t), '<' erases the last key, the matches of everything typed so far follow every line"""
+        extended_search = random.random() < 0.5
+        lines: list[str] = []
+        expected = ""
+        typed = ""
+        for _ in range(random.randint(1, 15)):
+            line = ""
+            for _ in range(random.randint(0, 3)):
+                if random.random() < 0.25:
+                    line += '<'
+                    typed = typed[:-1]
+                else:
+                    key = random.choice(string.digits + '+')
+                    line += key
+                    typed += key
+            lines.append(line)
+            expected += format_matches(self.pairs, reference_matches(self.pairs, typed or None, extended_search)) + "\n"
+        with open(self.generated_file + ".keys", 'w') as f:
+            f.writelines(line + "\n" for line in lines)
+        return [self.commands[0], "-f", self.generated_file, "-t", self.generated_file + ".keys"] + (["-s"] if extended_search else []), expected
+
+    def __ranked(self) -> tuple[list[str], str]:
+        """only the best matches (-l), best first, found by the linear scan, the subsequence search (-s) or the suffix index (-i)"""
+        search = random.choice(["", "-s", "-i"])
+        query = random_query()
+        limit = random.randint(1, 12)
+        ranks = reference_ranks(self.pairs, query, search == "-s")[:limit]
+        commands = [self.commands[0], "-f", self.generated_file, "-l", str(limit)] + ([search] if search else []) + ([query] if query is not None else [])
+        return commands, format_matches(self.pairs, [rank[-1] for rank in ranks])
+
+    def __batch(self) -> tuple[list[str], str]:
+        """a batch (-b) of mostly plain queries, the runs of them are matched together by the automaton and have to answer the same as the queries one by one"""
+        lines: list[str] = []
+        expected = ""
+        for _ in range(random.randint(1, 200)):
+            extended_search = random.random() < 0.1
+            query = random_query()
+            lines.append(("-s " if extended_search else "") + (query or ""))
+            expected += format_matches(self.pairs, reference_matches(self.pairs, query, extended_search)) + "\n"
+        with open(self.generated_file + ".queries", 'w') as f:
+            f.writelines(line + "\n" for line in lines)
+        return [self.commands[0], "-f", self.generated_file, "-b", self.generated_file + ".queries"] + random.choice([[], ["-j", "2"]]), expected
+
+    def __fuzzy(self) -> tuple[list[str], str]:
+        """matches within a few typos (-e), fewest typos first, optionally limited (-l)"""
+        query = ''.join(random.choices(string.digits + ('+' if random.random() < 0.2 else ''), k=random.randint(1, 8)))
+        max_errors = random.randint(1, 3)
+        limit = random.choice([0, 0, 1, 5])
+        ranks = reference_fuzzy(self.pairs, query, max_errors)
+        if limit > 0:
+            ranks = ranks[:limit]
+        commands = [self.commands[0], "-f", self.generated_file, "-e", str(max_errors)] + (["-l", str(limit)] if limit > 0 else []) + [query]
+        return commands, format_matches(self.pairs, [rank[-1] for rank in ranks])
+
+    def __stream(self) -> tuple[list[str], str]:
+        """the registry is matched while it is read from stdin (-p), the output has to be the one of the whole registry"""
+        extended_search = random.random() < 0.5
+        query = random_query()
+        commands = [self.commands[0], "-p"] + (["-s"] if extended_search else []) + ([query] if query is not None else []) + [f"<{self.generated_file}"]
+        return commands, format_matches(self.pairs, reference_matches(self.pairs, query, extended_search))
+
+    def __shards(self) -> tuple[list[str], str]:
+        """the registry split in several files (-f per shard), some of them compiled (-c), the merged matches have to be the ones of the whole registry"""
+        num_shards = min(random.randint(2, 4), len(self.pairs))
+        cuts = [0] + sorted(random.sample(range(1, len(self.pairs)), num_shards - 1)) + [len(self.pairs)]
+        commands = [self.commands[0]]
+        for k in range(num_shards):
+            shard = f"{self.generated_file}.shard{k}"
+            write_registry(shard, self.pairs[cuts[k]:cuts[k + 1]])
+            if random.random() < 0.5:
+                subprocess.run([self.commands[0], "-c", shard + ".img", "-f", shard], check=True)
+                shard += ".img"
+            commands += ["-f", shard]
+        kind = random.random()
+        if kind < 0.4:
+            extended_search = random.random() < 0.5
+            query = random_query()
+            commands += (["-s"] if extended_search else []) + ([query] if query is not None else [])
+            return commands, format_matches(self.pairs, reference_matches(self.pairs, query, extended_search))
+        if kind < 0.7:
+            extended_search = random.random() < 0.5
+            query = random_query()
+            limit = random.randint(1, 12)
+            ranks = reference_ranks(self.pairs, query, extended_search)[:limit]
+            commands += ["-l", str(limit)] + (["-s"] if extended_search else []) + ([query] if query is not None else [])
+            return commands, format_matches(self.pairs, [rank[-1] for rank in ranks])
+        query = ''.join(random.choices(string.digits, k=random.randint(1, 8)))
+        max_errors = random.randint(1, 3)
+        ranks = reference_fuzzy(self.pairs, query, max_errors)
+        commands += ["-e", str(max_errors), query]
+        return commands, format_matches(self.pairs, [rank[-1] for rank in ranks])
+
+    def __parallel(self) -> tuple[list[str], str]:
+        """a registry large enough to be scanned by several threads (-j), the matches (and the ranked ones, -l) of the chunks are merged in the registry order"""
+        self.pairs = [(random_string(random.randrange(1, 20)), ''.join(random.choices(string.digits, k=random.randrange(1, 12))))
+                      for _ in range(random.randint(PARALLEL_PAIRS_MIN, 4 * PARALLEL_PAIRS_MIN))]
+        write_registry(self.generated_file, self.pairs)
+        extended_search = random.random() < 0.5
+        query = ''.join(random.choices(string.digits + '+', k=random.randint(1, 5)))
+        limit = random.choice([0, 0, 1, 10, 100])
+        commands = [self.commands[0], "-f", self.generated_file, "-j", str(random.randint(2, 8))] + (["-s"] if extended_search else [])
+        if limit > 0:
+            ranks = reference_ranks(self.pairs, query, extended_search)[:limit]
+            return commands + ["-l", str(limit), query], format_matches(self.pairs, [rank[-1] for rank in ranks])
+        matches = reference_matches(self.pairs, query, extended_search)
+        # the counters of the threads are merged, every item is scanned once and every match is a hit of one of the fields
+        if random.random() < 0.5:
+            commands.append("-m")
+            hits = {"number": 0, "name": 0}
+            for i in matches:
+                number = fold(self.pairs[i][1])
+                hits["number" if (is_subsequence(fold(query), number) if extended_search else fold(query) in number) else "name"] += 1
+            self.expected_stats = {"queries": 1, "entries_scanned": len(self.pairs), "hits": hits}
+        return commands + [query], format_matches(self.pairs, matches)
+
+    def __run_parse(self) -> None:
+        """
+        a registry of several PARSE_CHUNK_SIZE_MIN is parsed by one thread and by several ones (-j), the chunks meet in the middle of the records,
+        the faults are put behind the first chunk, both runs have to stop at the same (the first) one, the valid registry has to give the matches of the reference
+        """
+        self.pairs = []
+        size = 0
+        target = random.randint(4, 8) * PARSE_CHUNK_SIZE_MIN
+        while size < target:
+            pair = (random_string(random.randrange(1, 30)), ''.join(random.choices(string.digits + '+', k=random.randrange(1, 20))))
+            self.pairs.append(pair)
+            size += len(pair[0]) + len(pair[1]) + 2
+        lines = [line for pair in self.pairs for line in pair]
+        faults = [] if random.random() < 0.25 else random.sample(["number", "long", "drop", "odd"], random.choice([1, 2, 2]))
+        # the latter lines first, so that the indexes of the former ones still hold
+        for fault in sorted(faults, key=lambda fault: fault == "odd", reverse=True):
+            k = random.randrange(len(lines) // 4, len(lines))
+            match fault:
+                case "number":
+                    k |= 1
+                    at = random.randrange(len(lines[k]))
+                    lines[k] = lines[k][:at] + random.choice(string.ascii_letters) + lines[k][at + 1:]
+                case "long":
+                    lines[k] = (random_string if k % 2 == 0 else lambda n: '1' * n)(random.randint(NAME_LENGTH_MAX + 1, 255))
+                case "drop":
+                    del lines[k]
+                case "odd":
+                    lines.append(random_string(random.randrange(1, 30)))
+        with open(self.generated_file, 'w') as f:
+            f.writelines(line + "\n" for line in lines)
+        query = random_query()
+        extended_search = random.random() < 0.5
+        runs = []
+        for num_threads in (1, 8):
+            commands = [self.commands[0], "-f", self.generated_file, "-j", str(num_threads)] + (["-s"] if extended_search else []) + ([query] if query is not None else [])
+            program_return = run_program(self.generated_file, ' '.join(commands))
+            with open('output.txt', 'r') as f:
+                runs.append((program_return[0], program_return[1], f.read()))
+        valid = runs[0][0] == 0 and runs[0][2] == format_matches(self.pairs, reference_matches(self.pairs, query, extended_search))
+        if runs[0] == runs[1] and (valid if not faults else runs[0][0] != 0):
+            print(f"Test [mode={self.mode.name}; faults={faults}; command={commands}]\x1b[32m passed\x1b[0m\n")
+        else:
+            print(f"For arguments {commands} (mode={self.mode.name}; faults={faults})\n The runs \x1b[31mdiffer\x1b[0m (returned {runs[0][0]}: {runs[0][1]} with a single thread, {runs[1][0]}: {runs[1][1]} with -j 8)\n")
+
+    def __run_server(self) -> None:
+        """
+        several clients query the server (-u) at once, each of them has to get the answers of the reference,
+        the registry is empty at times (nothing is indexed then) and the server has to stop cleanly on SIGTERM
+        """
+        if not hasattr(socket, "AF_UNIX"):
+            print("Server test skipped: no unix sockets")
+            return
+        if random.random() < 0.25:
+            self.pairs = []
+            write_registry(self.generated_file, self.pairs)
+        socket_path = self.generated_file + ".sock"
+        if path.exists(socket_path):
+            os.remove(socket_path)
+        commands = [self.commands[0], "-f", self.generated_file, "-u", socket_path, "-j", str(random.randint(2, 8))] + (["-i"] if random.random() < 0.5 else [])
+        lines: list[str] = []
+        expected = ""
+        for _ in range(random.randint(1, 50)):
+            extended_search = random.random() < 0.5
+            query = random_query()
+            lines.append(("-s " if extended_search else "") + (query or ""))
+            expected += format_matches(self.pairs, reference_matches(self.pairs, query, extended_search)) + "\n"
+        server = subprocess.Popen(commands, stderr=subprocess.DEVNULL)
+        for _ in range(500):
+            if path.exists(socket_path) or server.poll() is not None:
+                break
+            threading.Event().wait(0.01)
+        answers: list[str] = []
+        def client() -> None:
+            with socket.socket(socket.AF_UNIX) as connection:
+                connection.connect(socket_path)
+                connection.sendall(''.join(line + "\n" for line in lines).encode())
+                connection.shutdown(socket.SHUT_WR)
+                answer = b""
+                while data := connection.recv(65536):
+                    answer += data
+                answers.append(answer.decode())
+        clients = [threading.Thread(target=client) for _ in range(8)]
+        try:
+            for thread in clients:
+                thread.start()
+            for thread in clients:
+                thread.join(timeout=30)
+        finally:
+            server.send_signal(signal.SIGTERM)
+            try:
+                server.wait(timeout=10)
+            except subprocess.TimeoutExpired:
+                server.kill()
+                server.wait()
+        if len(answers) == len(clients) and all(answer == expected for answer in answers) and server.returncode == 0 and not path.exists(socket_path):
+            print(f"Test [mode={self.mode.name}; command={commands}]\x1b[32m passed\x1b[0m\n")
+        else:
+            print(f"For arguments {commands} (mode={self.mode.name})\n The answers \x1b[31mdiffer\x1b[0m from the reference ({len(answers)} of {len(clients)} clients answered, returned {server.returncode})\n")
+
 class Program:
     class Program_Run_Type(Enum):
         DEFAULT = ord('0')
         TIMER = ord('1')
+        DIFFERENTIAL = ord('2')
 
     @staticmethod
     def run():
         program_path = input("Enter program path: ")
-        type = ord(input("Enter program run type:\nDefault test[0]\nTimer test[1]")[0])
+        type = ord(input("Enter program run type:\nDefault test[0]\nTimer test[1]\nDifferential test[2]")[0])
         if not path.isdir("out"):
             os.mkdir("out")
         match type:
@@ -154,6 +573,8 @@ class Program:
                 Program.__def_run(program_path)
             case Program.Program_Run_Type.TIMER.value:
                 Program.__timer_run(program_path)
+            case Program.Program_Run_Type.DIFFERENTIAL.value:
+                Program.__differential_run(program_path)
             case _:
                 raise Exception("Invalid program type!")
 
@@ -228,10 +649,10 @@ class Program:
                 file.write(line)
         t.run_test()
 
-        # file too large
+        # file larger than NUM_PAIRS_MAX (the registry grows at runtime, so this has to pass)
         t = DefaultTest(
             TestFootprint(
-                _should_fail=(True, -5,),
+                _should_fail=(False, 0,),
                 extended_search=False,
                 t9_number_enabled=True), f"out/test_failure{5}.txt",
                 program_path=program_path);
@@ -280,6 +701,23 @@ class Program:
                 program_path=program_path).run_test();
         t.run_test()
 
+    def __differential_run(program_path: str):
+        for i in range(100):
+            DifferentialTest(
+                TestFootprint(
+                    _should_fail=(False, 0,),
+                    extended_search=i % 2 == 1,
+                    t9_number_enabled=True), f"out/test_differential{i}.txt",
+                    program_path=program_path).run_test()
+        for mode in list(DifferentialMode)[1:]:
+            for i in range(20):
+                DifferentialTest(
+                    TestFootprint(
+                        _should_fail=(False, 0,),
+                        extended_search=False,
+                        t9_number_enabled=False), f"out/test_differential_{mode.name.lower()}{i}.txt",
+                    program_path=program_path, mode=mode).run_test()
+
     def __timer_run(program_path: str):
         for _ in range(100):
             TimedTest(
@@ -8,13 +8,37 @@
 #include <stdint.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <errno.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 #if defined(_WIN32)
 #include <io.h>
+#include <windows.h>
+#define PSAPI_VERSION 2
+#include <psapi.h>
 #define is_stdin_redirected() !_isatty(_fileno(stdin))
+#define is_stdout_terminal() _isatty(_fileno(stdout))
+#define is_file_terminal(file) _isatty(_fileno(file))
 #elif defined(__unix__)
 #include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <signal.h>
+#include <time.h>
 #define is_stdin_redirected() !isatty(fileno(stdin))
+#define is_stdout_terminal() isatty(fileno(stdout))
+#define is_file_terminal(file) isatty(fileno(file))
 #else
 #pragma message("Unexpected operating system found. This means that you have to implement your own version of 'is_stdin_redirected' to enable correct program execution when no file redirection was performed")
 #endif
@@ -30,8 +54,8 @@
 #define MAX_LINE_WIDTH 100
 /** @brief alias for the maximum line width + termination character */
 #define MAX_STR_LEN MAX_LINE_WIDTH + 1
-/** @brief the maximum number of phone items supported */
-#define MAX_PHONE_ITEMS 100
+/** @brief initial size of every arena block, the block then grows geometrically */
+#define ARENA_INITIAL_CAPACITY (64 * 1024)
 
 #define todo() \
     printf("Not yet implemented [%s, %d]", __func__, __LINE__); \
@@ -43,14 +67,14 @@
 
 // to save up extra space on the stack
 typedef uint8_t String_Index;
-typedef uint8_t Phone_Item_Index;
+// the registry is bound only by the memory available, 32 bits are enough to address the items though
+typedef uint32_t Phone_Item_Index;
 
-#define MAX_SIZE(x)                 ((1 << (sizeof(x) * 8)) - 1)
+#define MAX_SIZE(x)                 ((x)~(x)0)
 #define STRING_INDEX_MAX_SIZE       MAX_SIZE(String_Index)
 #define PHONE_ITEM_INDEX_MAX_SIZE   MAX_SIZE(Phone_Item_Index)
 // ensure that the byte size for the indexes will suffice
 static_assert(STRING_INDEX_MAX_SIZE > MAX_STR_LEN, "Byte size for the String_Index is not large enough for the MAX_STR_LEN[=" stringify_dispatch(MAX_STR_LEN) "]");
-static_assert(PHONE_ITEM_INDEX_MAX_SIZE > MAX_PHONE_ITEMS, "Byte size for the Phone_Item_Index is not large enough for the MAX_STR_LEN[=" stringify_dispatch(MAX_STR_LEN) "]");
 
 // for [OUT]put parameters
 #if defined(__MSVC__)
@@ -75,6 +99,12 @@ typedef int Error;
 #define ERROR_FILE_TOO_LARGE (Error)-5
 #define ERROR_FILE_SIZE_MISMATCH (Error)-6
 #define ERROR_LINE_TOO_LARGE (Error)-7
+#define ERROR_FILE_OPEN (Error)-8
+#define ERROR_FILE_WRITE (Error)-9
+#define ERROR_INVALID_IMAGE (Error)-10
+#define ERROR_OUTPUT_WRITE (Error)-11
+#define ERROR_SOCKET (Error)-12
+#define ERROR_INVALID_EDIT (Error)-13
 
 // todo: error dump info
 /* @note we use variadics instead of __VA_ARGS__ macro just to avoid redundant parameters in case the format == printed message */
@@ -94,17 +124,23 @@ inline static void on_exit_error(Error error) {
     print_error("\x1b[31m[Error]:\x1b[0m ");
     print_error("\t%d\n", error);
     switch (error) {
-        register_error(ERROR_INVALID_NUMBER_OF_ARGS, "The number of arguments passed to the tnine.exe is either too small or too large\nThe possible arguments are: [optional]-s [optional]#number_to_be_searched_for [optional/debug build]-d\n");
+        register_error(ERROR_INVALID_NUMBER_OF_ARGS, "The number of arguments passed to the tnine.exe is either too small or too large\nThe possible arguments are: [optional]-s [optional]-i [optional]-p [optional]-m [optional]-f registry_file (repeated for every shard) [optional]-b queries_file [optional]-c image_file [optional]-t keystrokes_file [optional]-u socket_path [optional]-k scalar|sse2|avx2 [optional]-j num_threads [optional]-l limit [optional]-e max_errors [optional]#number_to_be_searched_for [optional/debug build]-d\n");
         register_error(ERORR_INVALID_NUMBER_ARG, "The argument [optional]#number_to_be_searched_for is not in valid number format!\n");
         register_error(ERORR_INVALID_NUMBER_ARG_LENGTH, "The argument [optional]#number_to_be_searched_for is larger than the MAX_STR_LEN[=" stringify_dispatch(MAX_STR_LEN) "]");
         register_error(ERROR_FILE_SIZE_MISMATCH, "The number of lines expected and the number of given lines is invalid!\n");
         register_error(ERROR_LINE_TOO_LARGE, "Line is larger than the max width (MAX=" stringify_dispatch(MAX_LINE_WIDTH) ")\n");
         register_error(ERROR_INVALID_NUMBER, "Number contains illegal characters\n");
-        register_error(ERROR_FILE_TOO_LARGE, "Stdin input is too large!\n");
+        register_error(ERROR_FILE_TOO_LARGE, "Stdin input is too large (could not allocate enough memory)!\n");
+        register_error(ERROR_FILE_OPEN, "The given file could not be opened!\n");
+        register_error(ERROR_FILE_WRITE, "The image could not be written!\n");
+        register_error(ERROR_INVALID_IMAGE, "The registry image is damaged or it was compiled by a different version of tnine!\n");
+        register_error(ERROR_OUTPUT_WRITE, "The matches could not be written to the output!\n");
+        register_error(ERROR_SOCKET, "The socket of the server could not be created (or the server is not supported on this system)!\n");
+        register_error(ERROR_INVALID_EDIT, "The edit of the registry is malformed or the id of its item does not exist!\n");
     }
 }
 
-/** @note it is fine to 'exit' the application intermittently if fatal error occurs, the program does not heap alloc at all */
+/** @note it is fine to 'exit' the application intermittently if fatal error occurs, the only heap memory are the arenas which are reclaimed by the OS anyway */
 #define do_exit(error) \
     do { \
         on_exit_error(error); \
@@ -119,6 +155,179 @@ inline static void on_exit_error(Error error) {
         } \
     } while(0)
 
+/* =========================================
+ *                   Stats
+ * ========================================= */
+
+#if defined(_MSC_VER)
+#define thread_local_storage __declspec(thread)
+#else
+#define thread_local_storage _Thread_local
+#endif
+
+/** @brief monotonic time in nanoseconds */
+static uint64_t clock_now(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+typedef enum _Stats_Phase {
+    STATS_PHASE_READ,
+    STATS_PHASE_PARSE,
+    STATS_PHASE_BUILD,
+    STATS_PHASE_MATCH,
+    STATS_PHASE_PRINT,
+    STATS_NUM_PHASES,
+} Stats_Phase;
+
+static const char* const stats_phase_names[STATS_NUM_PHASES] = { "read", "parse", "build", "match", "print" };
+
+/**
+ * @brief what the matching did
+ * @note the counters are bumped unconditionally (there is no branch on the hot paths), each thread into its own stats_local
+ */
+typedef struct _Stats_Counters {
+    /** @brief items (or session candidates) looked at */
+    uint64_t entries;
+    /** @brief calls of the find kernels and of subsequence_search */
+    uint64_t match_calls;
+    /** @brief occurrence offsets verified: positions passing the kernels' filter, suffixes of the -i range and offsets refined by the session */
+    uint64_t candidates;
+    uint64_t hits_number;
+    uint64_t hits_name;
+} Stats_Counters;
+
+/** @note unlike the stats_local, the stats are shared by all the threads, they are written only if enabled, and only by the main thread (-m cannot be combined with the server) */
+typedef struct _Stats {
+    /** @brief the phases are timed (and the stats reported) only if enabled (-m) */
+    int enabled;
+    uint64_t phases[STATS_NUM_PHASES];
+    uint64_t queries;
+} Stats;
+
+static Stats stats = { 0 };
+static thread_local_storage Stats_Counters stats_local = { 0 };
+
+inline static uint64_t stats_begin(void) {
+    return stats.enabled ? clock_now() : 0;
+}
+
+inline static void stats_end(Stats_Phase phase, uint64_t begin) {
+    if (stats.enabled) {
+        stats.phases[phase] += clock_now() - begin;
+    }
+}
+
+/** @brief adds the @param counters (of a finished worker thread) to the ones of the calling thread */
+static void stats_merge(const Stats_Counters* counters) {
+    stats_local.entries += counters->entries;
+    stats_local.match_calls += counters->match_calls;
+    stats_local.candidates += counters->candidates;
+    stats_local.hits_number += counters->hits_number;
+    stats_local.hits_name += counters->hits_name;
+}
+
+/** @return the largest resident size of the process so far (bytes), 0 if unknown */
+static uint64_t stats_peak_memory(void) {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? (uint64_t)counters.PeakWorkingSetSize : 0;
+#elif defined(__unix__)
+    struct rusage usage;
+    // ru_maxrss is in kilobytes
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? (uint64_t)usage.ru_maxrss * 1024 : 0;
+#else
+    return 0;
+#endif
+}
+
+/** @brief prints the stats of the main thread as one JSON line to stderr (registered with atexit if enabled) */
+static void stats_report(void) {
+    fprintf(stderr, "{\"phases_ns\": {");
+    for (int phase = 0; phase < STATS_NUM_PHASES; phase++) {
+        fprintf(stderr, "%s\"%s\": %llu", phase > 0 ? ", " : "", stats_phase_names[phase], (unsigned long long)stats.phases[phase]);
+    }
+    fprintf(stderr, "}, \"queries\": %llu, \"entries_scanned\": %llu, \"match_calls\": %llu, \"candidates\": %llu, \"hits\": {\"number\": %llu, \"name\": %llu}, \"peak_memory_bytes\": %llu}\n",
+        (unsigned long long)stats.queries, (unsigned long long)stats_local.entries, (unsigned long long)stats_local.match_calls,
+        (unsigned long long)stats_local.candidates, (unsigned long long)stats_local.hits_number, (unsigned long long)stats_local.hits_name,
+        (unsigned long long)stats_peak_memory());
+}
+
+/* =========================================
+ *                  Arena
+ * ========================================= */
+
+/**
+ * @brief one contiguous block of memory which is only ever bumped at the end and released all at once
+ * @note the block may move when it grows, hence everything living inside of an arena has to be referred to by an offset/index and never by a pointer kept across pushes
+ * @note an arena with memory but no capacity only borrows it (e.g. from a mapped image), it gets copied on the first push and it is never freed
+ */
+typedef struct _Arena {
+    char* memory;
+    size_t size;
+    size_t capacity;
+} Arena;
+
+/**
+ * @brief reserves @param num_bytes at the end of the @param arena
+ * @return offset of the reserved region from the beginning of the arena
+ */
+static size_t arena_push(Arena* arena, size_t num_bytes) {
+    if (arena->capacity < arena->size || num_bytes > arena->capacity - arena->size) {
+        size_t new_capacity = arena->capacity > 0 ? arena->capacity : ARENA_INITIAL_CAPACITY;
+        while (new_capacity < arena->size || new_capacity - arena->size < num_bytes) {
+            or_exit(new_capacity <= SIZE_MAX / 2, ERROR_FILE_TOO_LARGE);
+            new_capacity *= 2;
+        }
+        char* new_memory = NULL;
+        if (arena->capacity > 0 || arena->memory == NULL) {
+            new_memory = realloc(arena->memory, new_capacity);
+        } else if ((new_memory = malloc(new_capacity)) != NULL) {
+            memcpy(new_memory, arena->memory, arena->size);
+        }
+        or_exit(new_memory != NULL, ERROR_FILE_TOO_LARGE);
+        arena->memory = new_memory;
+        arena->capacity = new_capacity;
+    }
+    size_t offset = arena->size;
+    arena->size += num_bytes;
+    return offset;
+}
+
+/** @brief lets the @param arena use the @param memory it does not own */
+inline static void arena_borrow(Arena* arena, const char* memory, size_t size) {
+    arena->memory = (char*)memory;
+    arena->size = size;
+    arena->capacity = 0;
+}
+
+/** @brief copies the memory the @param arena borrows into its own (see arena_push), so that it can be written in place */
+inline static void arena_own(Arena* arena) {
+    if (arena->capacity == 0 && arena->size > 0) {
+        arena_push(arena, 0);
+    }
+}
+
+inline static void arena_free(Arena* arena) {
+    if (arena->capacity > 0) {
+        free(arena->memory);
+    }
+    arena->memory = NULL;
+    arena->size = 0;
+    arena->capacity = 0;
+}
+
+/** @brief accesses the arena's memory as an array of @param type */
+#define arena_as(arena, type) ((type*)(arena).memory)
+
 /* =========================================
  *                  Strings
  * ========================================= */
@@ -160,387 +369,4042 @@ inline static int string_is_number(String_View str) {
     return STR_SUCCESS;
 }
 
-#define is_upper(c) ((c) >= 'A' && (c) <= 'Z')
-#define is_lower(c) ((c) >= 'a' && (c) <= 'z')
-#define is_alpha(c) (is_lower((c)) || is_upper((c)))
+/* =========================================
+ *                   T9
+ * ========================================= */
+
+/** @brief encoding of a name character which cannot be typed by any of the T9 keys */
+#define T9_NO_KEY '_'
+
+#define t9_letter(lower, key) \
+    [lower] = key, [(lower) - 'a' + 'A'] = key
+
+/**
+ * @brief maps every character onto the T9 key it is typed with
+ * @note '0' and '+' share the same key, characters not present in the table (0) are not typeable
+ */
+static const char t9_keys[256] = {
+    ['0'] = '0', ['+'] = '0', ['1'] = '1',
+    t9_letter('a', '2'), t9_letter('b', '2'), t9_letter('c', '2'),
+    t9_letter('d', '3'), t9_letter('e', '3'), t9_letter('f', '3'),
+    t9_letter('g', '4'), t9_letter('h', '4'), t9_letter('i', '4'),
+    t9_letter('j', '5'), t9_letter('k', '5'), t9_letter('l', '5'),
+    t9_letter('m', '6'), t9_letter('n', '6'), t9_letter('o', '6'),
+    t9_letter('p', '7'), t9_letter('q', '7'), t9_letter('r', '7'), t9_letter('s', '7'),
+    t9_letter('t', '8'), t9_letter('u', '8'), t9_letter('v', '8'),
+    t9_letter('w', '9'), t9_letter('x', '9'), t9_letter('y', '9'), t9_letter('z', '9'),
+};
 
-inline static char to_lower(char c) {
-    if (!is_alpha(c)) {
-        return c;
+/**
+ * @brief encodes the @param name into the sequence of T9 keys it would be typed with
+ * @note digits other than '0' and '1' do not have a key of their own in the name (they share them with the letters), thus they are not typeable
+ */
+static void t9_encode_name(const char* restrict name, String_Index size, OUT char* restrict out_encoded) {
+    for (String_Index i = 0; i < size; i++) {
+        char key = t9_keys[(unsigned char)name[i]];
+        out_encoded[i] = key != 0 ? key : T9_NO_KEY;
     }
-    if (is_lower(c)) {
-        return c;
+    out_encoded[size] = '\0';
+}
+
+/** @brief encodes the @param number so that '+' and '0' become the same character */
+static void t9_encode_number(const char* restrict number, String_Index size, OUT char* restrict out_encoded) {
+    for (String_Index i = 0; i < size; i++) {
+        out_encoded[i] = number[i] == '+' ? '0' : number[i];
     }
-    return c + 32;
+    out_encoded[size] = '\0';
 }
 
 /* =========================================
- *                 SysArgs
+ *                  Kernels
  * ========================================= */
 
-typedef int Optional_Sys_Args_Footprint;
+/** @brief the haystacks passed to the kernels have to stay readable this many bytes past their end */
+#define KERNEL_PADDING 32
+#define STRING_NOT_FOUND STRING_INDEX_MAX_SIZE
 
-#define bit(x) (1 << (x))
-#define OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH bit(1)
-#define OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER bit(2)
-#define OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG  bit(3) 
-typedef struct _Sys_Args {
-    /** @brief we will store the optional arguments here, then later in the program we may determine whether or not to use the associated parameter inside the algorithm */
-    Optional_Sys_Args_Footprint optionals;
-    /**
-      * @note assuming the line width inside the text file can be 100, then the keyboard input should match the string
-      * @brief this is the number that can be submitted by the user
-      */
-    Sized_String keyboard_input;
-} Sys_Args;
+/**
+ * @brief finds the first occurrence of the @param needle inside of the @param haystack (plain byte comparison)
+ * @return offset of the occurrence or STRING_NOT_FOUND
+ */
+typedef String_Index (*Find_Kernel)(const char* restrict needle, String_Index needle_size, const char* restrict haystack, String_Index haystack_size);
+/** @brief same as t9_encode_name, @param readable is the number of bytes which can be read from the @param name (it may be less than KERNEL_PADDING past its end) */
+typedef void (*Encode_Kernel)(const char* restrict name, String_Index size, size_t readable, OUT char* restrict out_encoded);
 
-#ifdef DEBUG
-#define MAX_SYS_ARGS_COUNT 5 // 4 + debug
-#else
-#define MAX_SYS_ARGS_COUNT 4
-#endif
+typedef struct _Kernels {
+    const char* name;
+    Find_Kernel find;
+    Encode_Kernel encode_name;
+} Kernels;
 
-static Sys_Args validate_sys_args(int argc, char** argv) {
-    or_exit(argc < MAX_SYS_ARGS_COUNT, ERROR_INVALID_NUMBER_OF_ARGS);
-    Sys_Args args = {0};
-    if (argc > 1) {
-        String_Index current_arg = 1; // skip the first argument
-        /* check for optional parameter (-s) */
-        if (str_success(strcmp(argv[current_arg], "-s"))) {
-            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH;
-            // move to the next arg
-            current_arg++;
-            if (argc == current_arg) {
-                return args;
-            }
-        }
-        /* check for optional parameter (#number) */
-        if (str_success(string_is_number(argv[current_arg]))) {
-            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER;
-            // determine the length of the string
-            size_t str_size = strlen(argv[current_arg]);
-            or_exit(str_size < MAX_STR_LEN, ERORR_INVALID_NUMBER_ARG_LENGTH);
-            args.keyboard_input.size = (String_Index)str_size;
-            memcpy(&args.keyboard_input.string[0], argv[current_arg], args.keyboard_input.size);
-            current_arg++;
-            if (argc == current_arg) {
-                return args;
-            }
-        }
-#ifndef DEBUG
-        else {
-            do_exit(ERORR_INVALID_NUMBER_ARG);
+/** @brief the scalar kernels are the reference, every other one has to give the very same results */
+static String_Index _kernel_find_scalar(const char* restrict needle, String_Index needle_size, const char* restrict haystack, String_Index haystack_size) {
+    if (needle_size == 0 || needle_size > haystack_size) {
+        return STRING_NOT_FOUND;
+    }
+    const char* last = haystack + (haystack_size - needle_size);
+    unsigned tried = 0;
+    for (const char* candidate = haystack; candidate <= last; candidate++) {
+        candidate = memchr(candidate, needle[0], (size_t)(last - candidate) + 1);
+        if (candidate == NULL) {
+            break;
         }
-#else
-        /* check for optional parameter (-d) */
-        if (str_success(strcmp(argv[current_arg], "-d"))) {
-            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG;
-            // move to the next arg
-            current_arg++;
-            if (argc == current_arg) {
-                return args;
-            }
-        } else {
-            // todo: exit error
+        tried++;
+        if (memcmp(candidate, needle, needle_size) == 0) {
+            stats_local.candidates += tried;
+            return (String_Index)(candidate - haystack);
         }
-#endif
-        do_exit(ERROR_INVALID_NUMBER_OF_ARGS);
     }
-    return args;
+    stats_local.candidates += tried;
+    return STRING_NOT_FOUND;
 }
 
-/* =========================================
- *                   Phone
- * ========================================= */
-
-typedef struct _Phone_Item {
-    String name;
-    String number;
-} Phone_Item;
-
-typedef struct _Phone_Registry {
-    Phone_Item_Index num_items;
-    struct _Phone_Item items[MAX_PHONE_ITEMS];
-} Phone_Registry;
+static void _kernel_encode_scalar(const char* restrict name, String_Index size, size_t readable, OUT char* restrict out_encoded) {
+    (void)readable;
+    t9_encode_name(name, size, OUT out_encoded);
+}
 
-typedef struct _Phone_Registry_View {
-    Phone_Item_Index num_indexes;
-    Phone_Item_Index indexes[MAX_PHONE_ITEMS];
-} Phone_Registry_View;
+#if defined(KERNELS_X86)
 
-/** @note this is useful since cygwin's compiler emulations do not ommit Windows' \r from line ending */
-#if defined(__CYGWIN__)
-#define line_end(c) \
-    ((c) == '\r' || (c) == 10)
+#if defined(_MSC_VER)
+#define KERNEL_TARGET(isa)
+inline static unsigned _kernel_ctz(unsigned x) {
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return (unsigned)index;
+}
 #else
-#define line_end(c) \
-    ((c) == '\n')
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#define _kernel_ctz(x) ((unsigned)__builtin_ctz(x))
 #endif
 
 /**
- * @brief reads a line from stdin and writes the contents into the @param out_buff
+ * @brief compares the first and the last character of the needle at 16 haystack positions at once, only the positions where both of them match are verified
+ * @note the lanes past the last possible beginning of the needle are masked out
  */
-inline static int _parse_read_line(OUT String_View out_buff) {
-    char ch = 0;
-    String_Index num_chars = 0;
-    while ((ch = getchar()) != EOF && !line_end(ch)) {
-        or_exit(num_chars < MAX_LINE_WIDTH, ERROR_LINE_TOO_LARGE);
-        out_buff[num_chars++] = ch;
+KERNEL_TARGET("sse2")
+static String_Index _kernel_find_sse2(const char* restrict needle, String_Index needle_size, const char* restrict haystack, String_Index haystack_size) {
+    if (needle_size == 0 || needle_size > haystack_size) {
+        return STRING_NOT_FOUND;
     }
-#if defined(__CYGWIN__)
-    ch = getchar();
-#endif
-    out_buff[num_chars] = '\0';
-    // todo: test when EOF == '\n'
-    return (ch == EOF && num_chars == 0) ? STR_FAIL : STR_SUCCESS;
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_size - 1]);
+    unsigned num_positions = (unsigned)(haystack_size - needle_size) + 1;
+    unsigned tried = 0;
+    for (unsigned i = 0; i < num_positions; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + needle_size - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        if (num_positions - i < 16) {
+            mask &= (1u << (num_positions - i)) - 1;
+        }
+        for (; mask != 0; mask &= mask - 1) {
+            unsigned at = i + _kernel_ctz(mask);
+            tried++;
+            if (needle_size <= 2 || memcmp(haystack + at + 1, needle + 1, needle_size - 2) == 0) {
+                stats_local.candidates += tried;
+                return (String_Index)at;
+            }
+        }
+    }
+    stats_local.candidates += tried;
+    return STRING_NOT_FOUND;
 }
 
-/**
- * @brief scans the stdin for any Phone_Item(s), also validates the number being parsed
- */
-static void parse_file_contents(OUT Phone_Registry* restrict out_registry) {
-    for (; out_registry->num_items < MAX_PHONE_ITEMS; out_registry->num_items++) { // note: this size cannot exceed since we shall have already checked the file size when reading
-        // read name
-        char* name = out_registry->items[out_registry->num_items].name;
-        if (str_fail(_parse_read_line(OUT name))) { // this means that we have hit the EOF but we have to make sure that it was just a blank line and not a real name, in that case the file is incomplete
-            if (strlen(name) == 0) {
-                goto parsing_end;
-            }
-            do_exit(ERROR_FILE_SIZE_MISMATCH);
+/** @brief same as _kernel_find_sse2, 32 positions at once */
+KERNEL_TARGET("avx2")
+static String_Index _kernel_find_avx2(const char* restrict needle, String_Index needle_size, const char* restrict haystack, String_Index haystack_size) {
+    if (needle_size == 0 || needle_size > haystack_size) {
+        return STRING_NOT_FOUND;
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+    unsigned num_positions = (unsigned)(haystack_size - needle_size) + 1;
+    unsigned tried = 0;
+    for (unsigned i = 0; i < num_positions; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_size - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        if (num_positions - i < 32) {
+            mask &= (1u << (num_positions - i)) - 1;
         }
-        // read number
-        char* number = out_registry->items[out_registry->num_items].number;
-        if (str_fail(_parse_read_line(OUT number))) {
-            or_exit(str_success(string_is_number(number)), ERROR_INVALID_NUMBER);
-            out_registry->num_items++;
-            goto parsing_end;
+        for (; mask != 0; mask &= mask - 1) {
+            unsigned at = i + _kernel_ctz(mask);
+            tried++;
+            if (needle_size <= 2 || memcmp(haystack + at + 1, needle + 1, needle_size - 2) == 0) {
+                stats_local.candidates += tried;
+                return (String_Index)at;
+            }
         }
-        or_exit(str_success(string_is_number(number)), ERROR_INVALID_NUMBER);
     }
-
-    do_exit(ERROR_FILE_TOO_LARGE);
-
-parsing_end:
-    return;
+    stats_local.candidates += tried;
+    return STRING_NOT_FOUND;
 }
 
-// should return 0 on match and 1 on mismatch
-// todo: make the type more explicit since there is this inversed logic of 0 being 'true' and 1 being 'false'
-typedef int (*Substring_Match_Function)(char, char);
-
-/* @note technically we could merge the 'default_match' and 'is_in_t9_range' but there would be no difference... ?? */
-static int check_substring_match(Sized_String needle, String_View haystack, Substring_Match_Function match_function) {
+/**
+ * @brief encodes 32 name characters at once: the letters are lowered (| 0x20) and their keys are looked up by two pshufb(s) (a..p and q..z), '0'/'+' and '1' are compared directly
+ * @note the name is processed in whole blocks only if they are readable, the rest is left to the scalar encoding
+ */
+KERNEL_TARGET("avx2")
+static void _kernel_encode_avx2(const char* restrict name, String_Index size, size_t readable, OUT char* restrict out_encoded) {
+    const __m256i keys_low = _mm256_setr_epi8(
+        '2', '2', '2', '3', '3', '3', '4', '4', '4', '5', '5', '5', '6', '6', '6', '7',
+        '2', '2', '2', '3', '3', '3', '4', '4', '4', '5', '5', '5', '6', '6', '6', '7');
+    const __m256i keys_high = _mm256_setr_epi8(
+        '7', '7', '7', '8', '8', '8', '9', '9', '9', '9', 0, 0, 0, 0, 0, 0,
+        '7', '7', '7', '8', '8', '8', '9', '9', '9', '9', 0, 0, 0, 0, 0, 0);
     String_Index i = 0;
-    for (; haystack[i] != '\0' && i < needle.size; i++) {
-        if (str_fail(match_function(haystack[i], needle.string[i]))) {
-            return STR_FAIL;
-        }
+    char block[32];
+    for (; i < size && readable - i >= 32; i += 32) {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(name + i));
+        __m256i letter = _mm256_sub_epi8(_mm256_or_si256(chars, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+        __m256i is_letter = _mm256_cmpeq_epi8(_mm256_min_epu8(letter, _mm256_set1_epi8(25)), letter);
+        __m256i is_low = _mm256_cmpgt_epi8(_mm256_set1_epi8(16), letter);
+        __m256i keys = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(keys_high, _mm256_sub_epi8(letter, _mm256_set1_epi8(16))),
+            _mm256_shuffle_epi8(keys_low, letter), is_low);
+        __m256i is_zero = _mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('0')), _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('+')));
+        __m256i is_one = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('1'));
+        __m256i encoded = _mm256_set1_epi8(T9_NO_KEY);
+        encoded = _mm256_blendv_epi8(encoded, _mm256_set1_epi8('0'), is_zero);
+        encoded = _mm256_blendv_epi8(encoded, _mm256_set1_epi8('1'), is_one);
+        encoded = _mm256_blendv_epi8(encoded, keys, is_letter);
+        _mm256_storeu_si256((__m256i*)block, encoded);
+        memcpy(out_encoded + i, block, (size_t)(size - i) < 32 ? (size_t)(size - i) : 32);
     }
-    return needle.size == i ? STR_SUCCESS : STR_FAIL;
+    if (i < size) {
+        t9_encode_name(name + i, size - i, OUT out_encoded + i);
+    }
+    out_encoded[size] = '\0';
 }
 
-#define is_t9_zero(c) \
-    ((c) == '0' || (c) == '+' ? STR_SUCCESS : STR_FAIL)
-
-inline static int _0_agnostic_equals(char c1, char c2) {
-    if (str_success(is_t9_zero(c1))) {
-        return is_t9_zero(c2);
+static int _kernel_cpu_supports(const char* name) {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    if (str_success(strcmp(name, "sse2"))) {
+        return (info[3] >> 26) & 1;
+    }
+    // avx2 needs the OS to save the ymm registers as well
+    if (((info[2] >> 27) & 1) == 0 || ((info[2] >> 28) & 1) == 0 || (_xgetbv(0) & 6) != 6) {
+        return 0;
+    }
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return 0;
     }
-    return c1 == c2 ? STR_SUCCESS : STR_FAIL;
+    __cpuidex(info, 7, 0);
+    return (info[1] >> 5) & 1;
+#else
+    __builtin_cpu_init();
+    if (str_success(strcmp(name, "sse2"))) {
+        return __builtin_cpu_supports("sse2");
+    }
+    return __builtin_cpu_supports("avx2");
+#endif
 }
 
+#endif
+
+/** @brief all the kernels from the slowest to the fastest one */
+static const Kernels kernels_available[] = {
+    { "scalar", _kernel_find_scalar, _kernel_encode_scalar },
+#if defined(KERNELS_X86)
+    { "sse2", _kernel_find_sse2, _kernel_encode_scalar },
+    { "avx2", _kernel_find_avx2, _kernel_encode_avx2 },
+#endif
+};
+#define KERNELS_NUM_AVAILABLE (sizeof(kernels_available) / sizeof(kernels_available[0]))
+
+/** @brief the kernels in use, see kernels_select */
+static Kernels kernels = { "scalar", _kernel_find_scalar, _kernel_encode_scalar };
+
 /**
- * @brief case insensitive char comparison
- * @return 0 on success, 1 on fail
+ * @brief selects the fastest kernels the CPU supports, or the ones called @param name (NULL for the fastest)
+ * @return 0 on success and 1 if the requested kernels are unknown or not supported by this CPU
  */
-inline static int default_match(char c1, char c2) {
-    if (str_success(_0_agnostic_equals(c1, c2))) {
+static int kernels_select(const char* name) {
+    for (size_t i = KERNELS_NUM_AVAILABLE; i-- > 0;) {
+        const Kernels* candidate = &kernels_available[i];
+        if (name != NULL && str_fail(strcmp(name, candidate->name))) {
+            continue;
+        }
+#if defined(KERNELS_X86)
+        if (i > 0 && !_kernel_cpu_supports(candidate->name)) {
+            if (name != NULL) {
+                return STR_FAIL;
+            }
+            continue;
+        }
+#endif
+        kernels = *candidate;
         return STR_SUCCESS;
     }
-    return to_lower(c1) == to_lower(c2) ? STR_SUCCESS : STR_FAIL;
+    return STR_FAIL;
+}
+
+inline static String_Index string_find(const Sized_String* restrict needle, const char* restrict haystack, String_Index haystack_size) {
+    stats_local.match_calls++;
+    return kernels.find(needle->string, needle->size, haystack, haystack_size);
 }
 
-/* helper macro to check whether a given character satisfies lower <= ch <= upper */
-#define char_in_range(lower, ch, upper) \
-    (ch) >= (lower) && (ch) <= (upper) ? STR_SUCCESS : STR_FAIL    
+/* =========================================
+ *                  Mapping
+ * ========================================= */
+
+/** @brief read-only view of a whole file */
+typedef struct _File_Mapping {
+    const char* memory;
+    size_t size;
+#if defined(_WIN32)
+    HANDLE handle;
+#endif
+} File_Mapping;
 
 /**
- * @brief checks whether given param ch is mappable to the given param num
- * @return 0 on success, 1 on fail (note: it would not really make sense to use STR_FAIL since it is only char checking, but we should stick to the convention)
+ * @brief maps the whole @param file into the memory
+ * @return 0 on success and 1 on fail (the file is not a regular file, it is empty, or the OS does not support mapping)
+ * @note the position inside of the file is left untouched, so it can still be read if the mapping fails
  */
-static int is_in_t9_range(char ch, char num) {
-    ch = to_lower(ch);
-    switch (num) {
-    case '0':
-        return is_t9_zero(ch);
-    case '1':
-        return ch == '1' ? STR_SUCCESS : STR_FAIL;
-    case '7':
-        return char_in_range('p', ch, 's');
-    case '9':
-        return char_in_range('w', ch, 'z');
-    default:
-        // todo: how should we express the char shift to be more readable ???
-        return char_in_range((num - '0' - 2) * 3 + 'a', ch, (num - '0' - 1) * 3 + 'a' - 1);
+static int file_map(FILE* file, OUT File_Mapping* out_mapping) {
+#if defined(_WIN32)
+    HANDLE file_handle = (HANDLE)_get_osfhandle(_fileno(file));
+    LARGE_INTEGER file_size = { 0 };
+    if (file_handle == INVALID_HANDLE_VALUE || GetFileType(file_handle) != FILE_TYPE_DISK ||
+        !GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        return STR_FAIL;
+    }
+    HANDLE handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (handle == NULL) {
+        return STR_FAIL;
+    }
+    const char* memory = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    if (memory == NULL) {
+        CloseHandle(handle);
+        return STR_FAIL;
+    }
+    out_mapping->handle = handle;
+    out_mapping->memory = memory;
+    out_mapping->size = (size_t)file_size.QuadPart;
+    return STR_SUCCESS;
+#elif defined(__unix__)
+    struct stat file_stat;
+    int fd = fileno(file);
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size == 0) {
+        return STR_FAIL;
+    }
+    void* memory = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (memory == MAP_FAILED) {
+        return STR_FAIL;
     }
+    out_mapping->memory = memory;
+    out_mapping->size = (size_t)file_stat.st_size;
+    return STR_SUCCESS;
+#else
+    (void)file;
+    (void)out_mapping;
+    return STR_FAIL;
+#endif
+}
+
+static void file_unmap(File_Mapping* mapping) {
+    if (mapping->memory == NULL) {
+        return;
+    }
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping->memory);
+    CloseHandle(mapping->handle);
+#elif defined(__unix__)
+    munmap((void*)mapping->memory, mapping->size);
+#endif
+    mapping->memory = NULL;
+    mapping->size = 0;
 }
 
+/* =========================================
+ *                  Threads
+ * ========================================= */
+
+#if defined(_WIN32)
+typedef HANDLE Thread;
+#define thread_routine(name, arg) DWORD WINAPI name(LPVOID arg)
+#define THREAD_ROUTINE_RETURN 0
+#else
+typedef pthread_t Thread;
+#define thread_routine(name, arg) void* name(void* arg)
+#define THREAD_ROUTINE_RETURN NULL
+#endif
+
+/** @brief upper bound of the worker threads (-j), the scan is memory bound long before this */
+#define THREADS_MAX_COUNT 256
+
 /**
- * @brief scans for matches of param phone in the param registry, results are put inside param out_matches
+ * @brief runs the @param routine (declared by thread_routine) with the @param arg on a new thread
+ * @return 0 on success and 1 if the thread could not be created (the caller may run the routine itself then)
  */
-#ifdef DEBUG
-static void match(Sized_String phone, int debug_enabled, Phone_Registry* registry, OUT Phone_Registry_View* out_matches) {
+#if defined(_WIN32)
+static int thread_start(OUT Thread* out_thread, LPTHREAD_START_ROUTINE routine, void* arg) {
+    *out_thread = CreateThread(NULL, 0, routine, arg, 0, NULL);
+    return *out_thread != NULL ? STR_SUCCESS : STR_FAIL;
+}
 #else
-static void match(Sized_String phone, Phone_Registry* registry, OUT Phone_Registry_View* out_matches) {
-#endif
-    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
-        // check for number first (higher priority)
-        char* curr_number = registry->items[i].number;
-        char phone_placeholder = phone.string[0];
-        for (Phone_Item_Index j = 0; curr_number[j] != '\0'; j++) {
-            if (str_success(_0_agnostic_equals(curr_number[j], phone_placeholder)) && 
-                str_success(check_substring_match(phone, &curr_number[j], default_match))) {
-                out_matches->indexes[out_matches->num_indexes++] = i;
-#ifdef DEBUG
-                if (debug_enabled) {
-                    printf("Number matched at: %d\n%s\n", j, curr_number);
-                    String ranged_string = {0};
-                    for (Phone_Item_Index k = 0; k < strlen(curr_number); k++) {
-                        if (k >= j && k < j + phone.size) {
-                            ranged_string[k] = '^';
-                        } else {
-                            ranged_string[k] = ' ';
-                        }
-                    }
-                    printf("%s\n", ranged_string);
-                }
+static int thread_start(OUT Thread* out_thread, void* (*routine)(void*), void* arg) {
+    return pthread_create(out_thread, NULL, routine, arg) == 0 ? STR_SUCCESS : STR_FAIL;
+}
 #endif
-                break;
-            }
-        }
-        // check for name if number was not a match
-        char* curr_name = &registry->items[i].name[0];
-        for (Phone_Item_Index j = 0; curr_name[j] != '\0'; j++) {
-            // is_in_t9_range ensures that the substrings of name begin with valid t9 character
-            if ((is_in_t9_range(curr_name[j], phone_placeholder) == 0) && 
-                str_success(check_substring_match(phone, &curr_name[j], is_in_t9_range))) {
-                out_matches->indexes[out_matches->num_indexes++] = i;
-#ifdef DEBUG
-                if (debug_enabled) {
-                    printf("Name matched at: %d\n%s\n", j, curr_name);
-                    String ranged_string = {0};
-                    for (Phone_Item_Index k = 0; k < strlen(curr_name); k++) {
-                        if (k >= j && k < j + phone.size) {
-                            ranged_string[k] = '^';
-                        } else {
-                            ranged_string[k] = ' ';
-                        }
-                    }
-                    printf("%s\n", ranged_string);
-                }
+
+static void thread_join(Thread thread) {
+#if defined(_WIN32)
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
 #endif
-                break;
-            }
-        }
-    }
 }
 
-static int substring_search_ex(Sized_String phone, String_View view, Substring_Match_Function match_function) {
-    String_Index next_expect = 0;
-    char expects = phone.string[next_expect]; // note: this assumes that the length of the phone number is larger than 0, which makes sense since for blank phone number we have a case switch in `registry_match`....
-    next_expect++;
-    for (String_Index i = 0; i < strlen(view); i++) {
-        if (str_success(match_function(view[i], expects))) {
-            if (next_expect == phone.size) {
-                return STR_SUCCESS;
-            }
-            expects = phone.string[next_expect++];
-        }
-    }
-    // next_expect is always one ahead, i.e. if the whole phone.string is successfully found, it has to 'overflow' the size
-    return next_expect > phone.size ? STR_SUCCESS : STR_FAIL;
-}
+/* =========================================
+ *                  Output
+ * ========================================= */
 
-#define number_search_ex(phone, number) \
-    substring_search_ex(phone, number, default_match)
+/** @brief the matches are collected in a buffer of this size and written in blocks of (at most) it */
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+#define OUTPUT_STDOUT 1
 
-#define name_search_ex(phone, number) \
-    substring_search_ex(phone, number, is_in_t9_range)
+/** @brief writes the output with a few large writes of the file descriptor instead of one formatted stdio call per line */
+typedef struct _Output_Writer {
+    int fd;
+    /** @brief somebody is reading the output as it comes (a terminal), every result block is written right away then */
+    int interactive;
+    /** @brief a failed write only sets failed instead of exiting (the connections of the server), the rest of the output is dropped then */
+    int soft_errors;
+    int failed;
+    size_t size;
+    char buffer[OUTPUT_BUFFER_SIZE];
+} Output_Writer;
 
-static void match_ex(Sized_String phone, Phone_Registry* restrict registry, OUT Phone_Registry_View* restrict out_matches) {
-    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
-        char* curr_number = registry->items[i].number;
-        if (str_success(number_search_ex(phone, curr_number))) {
-            out_matches->indexes[out_matches->num_indexes++] = i;
+static Output_Writer output = { .fd = OUTPUT_STDOUT };
+
+/**
+ * @brief writes out (and empties) the buffer of the @param writer
+ * @return 0 on success and 1 if the output could not be written
+ * @note whatever was printed through stdio before goes first, so the order of the output is kept
+ */
+static int output_flush(Output_Writer* writer) {
+    if (writer->fd == OUTPUT_STDOUT) {
+        fflush(stdout);
+    }
+    const char* cursor = writer->buffer;
+    size_t left = writer->failed ? 0 : writer->size;
+    writer->size = 0;
+    while (left > 0) {
+#if defined(_WIN32)
+        int written = _write(writer->fd, cursor, (unsigned)left);
+#else
+        ssize_t written = write(writer->fd, cursor, left);
+        if (written < 0 && errno == EINTR) {
             continue;
         }
-        char* curr_name = registry->items[i].name;
-        if (str_success(name_search_ex(phone, curr_name))) {
-            out_matches->indexes[out_matches->num_indexes++] = i;
+#endif
+        if (written <= 0) {
+            writer->failed = 1;
+            return STR_FAIL;
         }
+        cursor += written;
+        left -= (size_t)written;
     }
+    return STR_SUCCESS;
 }
 
-static void registry_match(Sys_Args* restrict args, Phone_Registry* restrict registry, OUT Phone_Registry_View* restrict out_matches) {
-    // the number itself is not set, meaning we can copy everything and return immedeatly
-    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0) {
-        // note: we could set a special index to signify that we want to print everything, but is it worth it ??
-        for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
-            out_matches->indexes[out_matches->num_indexes++] = i;
-        }
-        return;
-    }
-    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) > 0) {
-        // optional search enabled
-        match_ex(args->keyboard_input, registry, out_matches);
-        return;
+/**
+ * @brief reserves @param size (at most OUTPUT_BUFFER_SIZE) contiguous bytes at the end of the buffer of the @param writer, flushing it first if they do not fit
+ * @return where the bytes are to be copied
+ */
+inline static char* output_reserve(Output_Writer* writer, size_t size) {
+    if (writer->size + size > OUTPUT_BUFFER_SIZE) {
+        or_exit(str_success(output_flush(writer)) || writer->soft_errors, ERROR_OUTPUT_WRITE);
     }
-#ifdef DEBUG
-    match(args->keyboard_input, args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG, registry, out_matches);
-#else
-    match(args->keyboard_input, registry, out_matches);
-#endif
+    char* at = writer->buffer + writer->size;
+    writer->size += size;
+    return at;
 }
 
-inline static void print_match(Phone_Item* item) {
-    printf("%s, %s\n", item->name, item->number);
+inline static void output_write(Output_Writer* writer, const char* data, size_t size) {
+    memcpy(output_reserve(writer, size), data, size);
 }
 
-/**
- * @brief for a give @param of registry, prints all the Phone_Items according to the mapping of @param registry_view
- */
-inline static void print_matches(Phone_Registry* restrict registry, Phone_Registry_View* restrict registry_view) {
-    if (registry_view->num_indexes == 0) {
-        printf("Not found\n");
-        return;
-    }
-    for (Phone_Item_Index i = 0; i < registry_view->num_indexes; i++) {
-        print_match(&registry->items[registry_view->indexes[i]]);
+/** @brief ends a result block, which is the moment to write the output if it is read interactively */
+inline static void output_end_block(Output_Writer* writer) {
+    if (writer->interactive) {
+        or_exit(str_success(output_flush(writer)), ERROR_OUTPUT_WRITE);
     }
 }
 
-int main(int argc, char** argv) {
-    
-    /* since we need to allocate a lot of memory... and also there is no need for them to be disposed during app's run time so we can just make them static */
-    static Sys_Args args = { 0 };
-    static Phone_Registry registry = { 0 };
-    static Phone_Registry_View matches = { 0 };
+/** @note registered with atexit, the output is not lost when the program exits on an error */
+static void output_flush_at_exit(void) {
+    output_flush(&output);
+}
 
-    if (!is_stdin_redirected()) {
-        printf("Input is not being redirected from a file. Was this your intention?\n");
-    }
+/* =========================================
+ *                 SysArgs
+ * ========================================= */
 
-    /* ensure the validity of sysargs */
-    args = validate_sys_args(argc, argv);
+typedef int Optional_Sys_Args_Footprint;
+
+#define bit(x) (1 << (x))
+#define OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH bit(1)
+#define OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER bit(2)
+#define OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG  bit(3)
+#define OPTIONAL_SYS_ARG_FOOTPRINT_INDEX  bit(4)
+#define OPTIONAL_SYS_ARG_FOOTPRINT_STATS  bit(5)
+#define OPTIONAL_SYS_ARG_FOOTPRINT_STREAM bit(6)
+
+/** @brief upper bound of the registry files (-f) matched as the shards of one registry */
+#define SHARDS_MAX_COUNT 64
+
+typedef struct _Sys_Args {
+    /** @brief we will store the optional arguments here, then later in the program we may determine whether or not to use the associated parameter inside the algorithm */
+    Optional_Sys_Args_Footprint optionals;
+    /**
+      * @note assuming the line width inside the text file can be 100, then the keyboard input should match the string
+      * @brief this is the number that can be submitted by the user
+      */
+    Sized_String keyboard_input;
+    /** @brief the registry is read from this file instead of stdin (-f), the first shard if there are more of them */
+    const char* registry_path;
+    /** @brief every registry file (-f) in the order given, each one is loaded and matched on its own and the matches are merged (see run_shards) */
+    const char* shard_paths[SHARDS_MAX_COUNT];
+    unsigned num_shards;
+    /** @brief the keyboard inputs are read line by line from this file ("-" for stdin) and all of them are matched against the same registry (-b) */
+    const char* batch_path;
+    /** @brief the parsed registry (with all of its indexes) is written into this image instead of matching anything (-c) */
+    const char* compile_path;
+    /** @brief name of the matching kernels to use instead of the fastest supported ones (-k) */
+    const char* kernel;
+    /** @brief the keystrokes are read line by line from this file ("-" for stdin), the matches are refined after every line (-t) */
+    const char* session_path;
+    /** @brief the registry (-f) is served on this Unix domain socket until the server is stopped, SIGHUP reloads it (-u) */
+    const char* serve_path;
+    /** @brief number of threads scanning the registry (-j), 0 is the same as 1, the number of workers of the server (-u) */
+    unsigned num_threads;
+    /** @brief only this many best ranked matches are printed (-l), 0 prints all of them in the registry order */
+    Phone_Item_Index limit;
+    /** @brief the keyboard input may be matched with up to this many typos (-e), the matches are then ordered by the number of them */
+    String_Index max_errors;
+} Sys_Args;
+
+/**
+ * @brief validates the @param arg as the keyboard input and stores it inside of the @param args
+ * @return the error instead of exiting, the queries of the server must not stop it
+ */
+static Error _sys_args_try_number(Sys_Args* args, const char* arg) {
+    /* there can be only one, anything else is either a second number or an unknown option */
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) != 0) {
+        return ERROR_INVALID_NUMBER_OF_ARGS;
+    }
+    if (str_fail(string_is_number((String_View)arg))) {
+        return arg[0] == '-' ? ERROR_INVALID_NUMBER_OF_ARGS : ERORR_INVALID_NUMBER_ARG;
+    }
+    // determine the length of the string
+    size_t str_size = strlen(arg);
+    if (str_size >= MAX_STR_LEN) {
+        return ERORR_INVALID_NUMBER_ARG_LENGTH;
+    }
+    args->optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER;
+    args->keyboard_input.size = (String_Index)str_size;
+    memcpy(&args->keyboard_input.string[0], arg, args->keyboard_input.size);
+    return ERROR_NONE;
+}
+
+/** @brief same as _sys_args_try_number, exits on error */
+static void _sys_args_set_number(Sys_Args* args, const char* arg) {
+    Error error = _sys_args_try_number(args, arg);
+    if (error != ERROR_NONE) {
+        do_exit(error);
+    }
+}
+
+/** @brief returns the value of the option at @param current_arg and moves past it */
+static const char* _sys_args_value(int argc, char** argv, int* current_arg) {
+    or_exit(*current_arg + 1 < argc, ERROR_INVALID_NUMBER_OF_ARGS);
+    return argv[++*current_arg];
+}
+
+/** @brief returns the value of the option at @param current_arg as a count in 1..@param max and moves past it */
+static unsigned long _sys_args_count(int argc, char** argv, int* current_arg, unsigned long max) {
+    const char* value = _sys_args_value(argc, argv, current_arg);
+    or_exit(str_success(string_is_number((String_View)value)) && strchr(value, '+') == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    unsigned long count = strtoul(value, NULL, 10);
+    or_exit(count >= 1 && count <= max, ERROR_INVALID_NUMBER_OF_ARGS);
+    return count;
+}
+
+static Sys_Args validate_sys_args(int argc, char** argv) {
+    Sys_Args args = {0};
+    for (int current_arg = 1; current_arg < argc; current_arg++) { // skip the first argument
+        const char* arg = argv[current_arg];
+        /* check for optional parameter (-s) */
+        if (str_success(strcmp(arg, "-s"))) {
+            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH;
+            continue;
+        }
+        /* check for optional parameter (-i) */
+        if (str_success(strcmp(arg, "-i"))) {
+            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_INDEX;
+            continue;
+        }
+        /* check for optional parameter (-p) */
+        if (str_success(strcmp(arg, "-p"))) {
+            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_STREAM;
+            continue;
+        }
+        /* check for optional parameter (-m) */
+        if (str_success(strcmp(arg, "-m"))) {
+            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_STATS;
+            continue;
+        }
+#ifdef DEBUG
+        /* check for optional parameter (-d) */
+        if (str_success(strcmp(arg, "-d"))) {
+            args.optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG;
+            continue;
+        }
+#endif
+        /* check for optional parameter (-f registry_file), repeated for every shard */
+        if (str_success(strcmp(arg, "-f"))) {
+            or_exit(args.num_shards < SHARDS_MAX_COUNT, ERROR_INVALID_NUMBER_OF_ARGS);
+            args.shard_paths[args.num_shards++] = _sys_args_value(argc, argv, &current_arg);
+            args.registry_path = args.shard_paths[0];
+            continue;
+        }
+        /* check for optional parameter (-b queries_file) */
+        if (str_success(strcmp(arg, "-b"))) {
+            args.batch_path = _sys_args_value(argc, argv, &current_arg);
+            continue;
+        }
+        /* check for optional parameter (-t keystrokes_file) */
+        if (str_success(strcmp(arg, "-t"))) {
+            args.session_path = _sys_args_value(argc, argv, &current_arg);
+            continue;
+        }
+        /* check for optional parameter (-u socket_path) */
+        if (str_success(strcmp(arg, "-u"))) {
+            args.serve_path = _sys_args_value(argc, argv, &current_arg);
+            continue;
+        }
+        /* check for optional parameter (-c image_file) */
+        if (str_success(strcmp(arg, "-c"))) {
+            args.compile_path = _sys_args_value(argc, argv, &current_arg);
+            continue;
+        }
+        /* check for optional parameter (-k scalar|sse2|avx2) */
+        if (str_success(strcmp(arg, "-k"))) {
+            args.kernel = _sys_args_value(argc, argv, &current_arg);
+            continue;
+        }
+        /* check for optional parameter (-j num_threads) */
+        if (str_success(strcmp(arg, "-j"))) {
+            args.num_threads = (unsigned)_sys_args_count(argc, argv, &current_arg, THREADS_MAX_COUNT);
+            continue;
+        }
+        /* check for optional parameter (-l limit) */
+        if (str_success(strcmp(arg, "-l"))) {
+            args.limit = (Phone_Item_Index)_sys_args_count(argc, argv, &current_arg, PHONE_ITEM_INDEX_MAX_SIZE - 1);
+            continue;
+        }
+        /* check for optional parameter (-e max_errors) */
+        if (str_success(strcmp(arg, "-e"))) {
+            args.max_errors = (String_Index)_sys_args_count(argc, argv, &current_arg, MAX_LINE_WIDTH);
+            continue;
+        }
+        /* check for optional parameter (#number) */
+        _sys_args_set_number(&args, arg);
+    }
+    or_exit(str_success(kernels_select(args.kernel)), ERROR_INVALID_NUMBER_OF_ARGS);
+    if (args.compile_path != NULL) {
+        // nothing is matched when compiling
+        or_exit((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0 && args.batch_path == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if (args.batch_path != NULL) {
+        // the keyboard inputs come from the batch and stdin cannot hold both the registry and the batch
+        or_exit((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0, ERROR_INVALID_NUMBER_OF_ARGS);
+        or_exit(args.registry_path != NULL || str_fail(strcmp(args.batch_path, "-")), ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if (args.serve_path != NULL) {
+        // the queries come from the connections, the registry is read again from its file on reload
+        or_exit((args.optionals & (OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER | OPTIONAL_SYS_ARG_FOOTPRINT_STATS)) == 0 && args.registry_path != NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+        or_exit(args.batch_path == NULL && args.compile_path == NULL && args.session_path == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if (args.max_errors > 0) {
+        // the typos are looked for by the linear scan only
+        or_exit((args.optionals & (OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH | OPTIONAL_SYS_ARG_FOOTPRINT_INDEX)) == 0 && args.session_path == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if ((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_STREAM) != 0) {
+        // only the record being read is kept, there is nothing to index, rank, split between threads or match again
+        or_exit((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_INDEX) == 0 && args.limit == 0 && args.max_errors == 0 && args.num_threads == 0, ERROR_INVALID_NUMBER_OF_ARGS);
+        or_exit(args.batch_path == NULL && args.compile_path == NULL && args.session_path == NULL && args.serve_path == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if (args.num_shards > 1) {
+        // the shards are matched once and only read, there is no single registry to compile, edit, stream or match again
+        or_exit((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_STREAM) == 0, ERROR_INVALID_NUMBER_OF_ARGS);
+        or_exit(args.batch_path == NULL && args.compile_path == NULL && args.session_path == NULL && args.serve_path == NULL, ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    if (args.session_path != NULL) {
+        // same as the batch, the keyboard input is typed during the session
+        or_exit((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0 && args.batch_path == NULL && args.compile_path == NULL && args.limit == 0, ERROR_INVALID_NUMBER_OF_ARGS);
+        or_exit(args.registry_path != NULL || str_fail(strcmp(args.session_path, "-")), ERROR_INVALID_NUMBER_OF_ARGS);
+    }
+    return args;
+}
+
+/* =========================================
+ *                   Phone
+ * ========================================= */
+
+/** @brief offset into one of the text arenas of the registry */
+typedef uint64_t Text_Offset;
+
+/**
+ * @brief everything the matching reads about an item, 16 bytes so that the linear scans stream through 4 of them per cache line
+ * @note the item does not hold any characters, only a slice of the registry's t9 arena, the rest of it is kept aside in Phone_Item_Text
+ */
+typedef struct _Phone_Item {
+    /** @brief the number and the name encoded by t9_encode_number/t9_encode_name (in this order), both terminated by '\0', matching is done on these only */
+    Text_Offset t9;
+    String_Index name_size;
+    String_Index number_size;
+    /** @brief ITEM_FLAG_* set by the edits of the registry (see Edit), 0 for every item as parsed */
+    uint8_t flags;
+} Phone_Item;
+static_assert(sizeof(Phone_Item) == 16, "Phone_Item no longer fits 4 times into a cache line");
+
+/** @brief slices of the registry's text (the input itself) an item was made of, read only to print it */
+typedef struct _Phone_Item_Text {
+    Text_Offset name;
+    Text_Offset number;
+} Phone_Item_Text;
+
+/** @brief bit k is set if the key '0' + k occurs in an encoded field (or in a keyboard input), see digit_mask */
+typedef uint16_t Digit_Mask;
+/** @brief set in the mask of a keyboard input containing a character that none of the encoded names has ('+') */
+#define DIGIT_MASK_OTHER bit(15)
+
+/**
+ * @brief Digit_Mask of the t9_number (low half) and of the t9_name (high half) of an item
+ * @note a field can contain the keyboard input only if it has all of its keys, most of the items are rejected by this alone (see signature_missing)
+ */
+typedef uint32_t Item_Signature;
+#define SIGNATURE_NUMBER ((Item_Signature)0xffff)
+#define SIGNATURE_NAME ((Item_Signature)0xffff << 16)
+#define signature_make(number_mask, name_mask) ((Item_Signature)(number_mask) | (Item_Signature)(name_mask) << 16)
+/** @brief the keys of the @param query (signature of the keyboard input) missing in the fields of the item's @param signature, the item can match only in the fields whose half is 0 */
+#define signature_missing(signature, query) ((query) & ~(signature))
+/** @brief whether neither of the fields can match (the @param missing keys are in both halves) */
+#define signature_rejects(missing) (((missing) & SIGNATURE_NUMBER) != 0 && ((missing) & SIGNATURE_NAME) != 0)
+
+/** @brief the keys of the @param keys, any other character sets the @param other bits */
+static Digit_Mask digit_mask(const char* keys, String_Index size, Digit_Mask other) {
+    Digit_Mask mask = 0;
+    for (String_Index i = 0; i < size; i++) {
+        unsigned key = (unsigned)(unsigned char)keys[i] - '0';
+        mask |= key < 10 ? (Digit_Mask)bit(key) : other;
+    }
+    return mask;
+}
+
+/** @brief the item was deleted, it stays in place (so that the indexes of the others do not move) until registry_compact */
+#define ITEM_FLAG_TOMBSTONE bit(0)
+/** @brief the item was added or updated after the suffix index was built, its suffixes there (if any) are stale, see Suffix_Index.delta */
+#define ITEM_FLAG_UNINDEXED bit(1)
+
+/**
+ * @brief suffix array over the encoded fields of all the Phone_Item(s)
+ * @note built only on demand (-i), see index_build
+ */
+typedef struct _Suffix_Index {
+    /** @brief t9_number and t9_name of every item, each one followed by INDEX_SEPARATOR (char) */
+    Arena text;
+    /** @brief offsets of all the non-separator suffixes of the text in lexicographical order (Index_Offset) */
+    Arena suffixes;
+    /** @brief offset of every field inside of the text, 2 * i is the number and 2 * i + 1 the name of the i-th item (Index_Offset) */
+    Arena fields;
+    /** @brief the items edited since the index was built (Phone_Item_Index), these are scanned linearly instead */
+    Arena delta;
+} Suffix_Index;
+
+/** @brief number of distinct characters of the encoded fields which can be typed ('0'..'9') */
+#define T9_NUM_KEYS 10
+
+/** @brief positions of every key inside of one encoded field, grouped by the key */
+typedef struct _Subsequence_Table {
+    /** @brief beginning of the field's positions inside of Subsequence_Index.positions */
+    uint32_t base;
+    /** @brief positions of the key k are at base + starts[k] .. base + starts[k + 1] (exclusive) */
+    String_Index starts[T9_NUM_KEYS + 1];
+} Subsequence_Table;
+
+/**
+ * @brief per field position tables for the subsequence search (-s)
+ * @note built only on demand, see subsequence_build
+ */
+typedef struct _Subsequence_Index {
+    /** @brief 2 * i is the number and 2 * i + 1 the name of the i-th item (Subsequence_Table) */
+    Arena tables;
+    /** @brief ascending positions of the keys in the fields (String_Index) */
+    Arena positions;
+} Subsequence_Index;
+
+typedef struct _Phone_Registry {
+    Phone_Item_Index num_items;
+    /** @brief contiguous array of Phone_Item(s) */
+    Arena items;
+    /** @brief contiguous array of Phone_Item_Text(s), the i-th one belongs to the i-th item */
+    Arena item_texts;
+    /** @brief contiguous array of Item_Signature(s), the i-th one belongs to the i-th item, the scans go through it before they touch the item itself */
+    Arena signatures;
+    /** @brief the names and the numbers the items refer to */
+    Arena text;
+    /** @brief the encoded numbers and names the items refer to, followed by KERNEL_PADDING zeroes */
+    Arena t9;
+    Suffix_Index index;
+    Subsequence_Index subsequences;
+    /**
+     * @brief current index of the item with the id i (Phone_Item_Index), EDIT_ID_NONE once it is deleted
+     * @note created by the first edit, until then the id of every item is its index (the order of the input)
+     */
+    Arena ids;
+    /** @brief tombstones and stale versions of the updated items, reclaimed by registry_compact */
+    Phone_Item_Index num_garbage;
+    /** @brief the whole registry input (text or image), the arenas above may borrow their memory from it */
+    Arena source;
+    /** @brief the mapped registry input (if it could be mapped) the source borrows its memory from */
+    File_Mapping mapping;
+} Phone_Registry;
+
+typedef struct _Phone_Registry_View {
+    Phone_Item_Index num_indexes;
+    /** @brief contiguous array of Phone_Item_Index(es) into the viewed registry */
+    Arena indexes;
+    /** @brief if set, the ranked matches also keep their Match_Rank(s) here (see match_top_drain), the matches of the shards are merged along them */
+    Arena* ranks;
+} Phone_Registry_View;
+
+#define registry_item(registry, i) (&arena_as((registry)->items, Phone_Item)[(i)])
+#define registry_item_text(registry, i) (&arena_as((registry)->item_texts, Phone_Item_Text)[(i)])
+#define registry_signature(registry, i) (arena_as((registry)->signatures, Item_Signature)[(i)])
+#define item_name(registry, i) ((registry)->text.memory + registry_item_text((registry), (i))->name)
+#define item_number(registry, i) ((registry)->text.memory + registry_item_text((registry), (i))->number)
+#define item_t9_number(registry, item) ((registry)->t9.memory + (item)->t9)
+#define item_t9_name(registry, item) (item_t9_number((registry), (item)) + (item)->number_size + 1)
+#define view_index(view, i) (arena_as((view)->indexes, Phone_Item_Index)[(i)])
+
+/** @brief the items begin..end (exclusive) of a registry, the linear scans can be split along these */
+typedef struct _Phone_Item_Range {
+    Phone_Item_Index begin;
+    Phone_Item_Index end;
+} Phone_Item_Range;
+
+/**
+ * @brief appends a new zeroed Phone_Item at the end of the @param registry
+ * @note the returned pointer is valid only until the next push
+ */
+static Phone_Item* registry_push(Phone_Registry* registry) {
+    or_exit(registry->num_items < PHONE_ITEM_INDEX_MAX_SIZE, ERROR_FILE_TOO_LARGE);
+    size_t offset = arena_push(&registry->items, sizeof(Phone_Item));
+    Phone_Item* item = (Phone_Item*)(registry->items.memory + offset);
+    memset(item, 0, sizeof(Phone_Item));
+    offset = arena_push(&registry->item_texts, sizeof(Phone_Item_Text));
+    memset(registry->item_texts.memory + offset, 0, sizeof(Phone_Item_Text));
+    offset = arena_push(&registry->signatures, sizeof(Item_Signature));
+    memset(registry->signatures.memory + offset, 0, sizeof(Item_Signature));
+    registry->num_items++;
+    return item;
+}
+
+static void registry_free(Phone_Registry* registry) {
+    arena_free(&registry->ids);
+    arena_free(&registry->subsequences.positions);
+    arena_free(&registry->subsequences.tables);
+    arena_free(&registry->index.delta);
+    arena_free(&registry->index.fields);
+    arena_free(&registry->index.suffixes);
+    arena_free(&registry->index.text);
+    arena_free(&registry->t9);
+    arena_free(&registry->text);
+    arena_free(&registry->signatures);
+    arena_free(&registry->item_texts);
+    arena_free(&registry->items);
+    arena_free(&registry->source);
+    file_unmap(&registry->mapping);
+    registry->num_items = 0;
+    registry->num_garbage = 0;
+}
+
+inline static void view_clear(Phone_Registry_View* view) {
+    view->num_indexes = 0;
+    view->indexes.size = 0;
+}
+
+inline static void view_push(Phone_Registry_View* view, Phone_Item_Index index) {
+    arena_push(&view->indexes, sizeof(Phone_Item_Index));
+    view_index(view, view->num_indexes++) = index;
+}
+
+/**
+ * @brief how well an item matches (-l), the smaller the better: the number before the name, an earlier occurrence (so a prefix first) and then the registry order
+ * @note packed into one integer so that the ranks can be compared directly
+ */
+typedef uint64_t Match_Rank;
+
+#define MATCH_FIELD_NUMBER 0
+#define MATCH_FIELD_NAME 1
+#define match_rank(field, at, index) (((Match_Rank)(field) << 40) | ((Match_Rank)(at) << 32) | (Match_Rank)(index))
+#define match_rank_item(rank) ((Phone_Item_Index)(rank))
+/** @brief the fuzzy matches (-e) are ranked by their edit distance first */
+#define match_rank_fuzzy(distance, field, at, index) (((Match_Rank)(distance) << 48) | match_rank((field), (at), (index)))
+/** @brief no item after the ranked ones can beat a number prefix (it would have a larger index) */
+#define match_rank_unbeatable(rank) ((rank) < match_rank(MATCH_FIELD_NUMBER, 1, 0))
+
+/** @brief the best ranked matches seen so far, kept in a max-heap of at most limit ranks (the worst one on the top) */
+typedef struct _Match_Top {
+    Phone_Item_Index limit;
+    Phone_Item_Index size;
+    /** @brief Match_Rank(s) */
+    Arena heap;
+} Match_Top;
+
+#define match_top_rank(top, i) (arena_as((top)->heap, Match_Rank)[(i)])
+
+/**
+ * @brief offers the @param rank to the @param top
+ * @return 0 if the scan should go on and 1 if the top is full of ranks nothing later in the registry can beat
+ */
+static int match_top_push(Match_Top* top, Match_Rank rank) {
+    if (top->size < top->limit) {
+        if ((size_t)top->size * sizeof(Match_Rank) == top->heap.size) {
+            arena_push(&top->heap, sizeof(Match_Rank));
+        }
+        Phone_Item_Index child = top->size++;
+        while (child > 0 && match_top_rank(top, (child - 1) / 2) < rank) {
+            match_top_rank(top, child) = match_top_rank(top, (child - 1) / 2);
+            child = (child - 1) / 2;
+        }
+        match_top_rank(top, child) = rank;
+    } else if (rank < match_top_rank(top, 0)) {
+        Phone_Item_Index parent = 0;
+        for (;;) {
+            Phone_Item_Index child = 2 * parent + 1;
+            if (child >= top->size) {
+                break;
+            }
+            if (child + 1 < top->size && match_top_rank(top, child + 1) > match_top_rank(top, child)) {
+                child++;
+            }
+            if (match_top_rank(top, child) <= rank) {
+                break;
+            }
+            match_top_rank(top, parent) = match_top_rank(top, child);
+            parent = child;
+        }
+        match_top_rank(top, parent) = rank;
+    }
+    return top->size == top->limit && match_rank_unbeatable(match_top_rank(top, 0)) ? STR_FAIL : STR_SUCCESS;
+}
+
+static int _match_top_compare(const void* a, const void* b) {
+    Match_Rank x = *(const Match_Rank*)a, y = *(const Match_Rank*)b;
+    return (x > y) - (x < y);
+}
+
+/** @brief appends the items of the @param top to the @param out_matches from the best one, the top is emptied */
+static void match_top_drain(Match_Top* restrict top, OUT Phone_Registry_View* restrict out_matches) {
+    if (top->size > 0) {
+        qsort(top->heap.memory, top->size, sizeof(Match_Rank), _match_top_compare);
+    }
+    for (Phone_Item_Index i = 0; i < top->size; i++) {
+        view_push(out_matches, match_rank_item(match_top_rank(top, i)));
+    }
+    if (out_matches->ranks != NULL && top->size > 0) {
+        size_t offset = arena_push(out_matches->ranks, top->size * sizeof(Match_Rank));
+        memcpy(out_matches->ranks->memory + offset, top->heap.memory, top->size * sizeof(Match_Rank));
+    }
+    top->size = 0;
+}
+
+/**
+ * @brief reports the item @param index matching at @param at of the @param field, into the @param top if the matches are ranked (not NULL) and into the @param out_matches otherwise
+ * @return 0 if the scan should go on and 1 if it can stop (see match_top_push)
+ */
+inline static int match_found(Match_Top* restrict top, Phone_Registry_View* restrict out_matches, int field, String_Index at, Phone_Item_Index index) {
+    if (field == MATCH_FIELD_NUMBER) {
+        stats_local.hits_number++;
+    } else {
+        stats_local.hits_name++;
+    }
+    if (top != NULL) {
+        return match_top_push(top, match_rank(field, at, index));
+    }
+    view_push(out_matches, index);
+    return STR_SUCCESS;
+}
+
+/** @brief the registry input which cannot be mapped is read in blocks of this size */
+#define PARSE_BLOCK_SIZE (1024 * 1024)
+
+/**
+ * @brief loads the whole @param input into the source of the @param out_registry, mapping it if @param mappable and possible
+ * @note the items then only refer to the lines of the source, nothing is copied line by line
+ */
+static void registry_read_source(FILE* input, int mappable, OUT Phone_Registry* restrict out_registry) {
+    if (mappable && str_success(file_map(input, OUT &out_registry->mapping))) {
+        arena_borrow(&out_registry->source, out_registry->mapping.memory, out_registry->mapping.size);
+        return;
+    }
+    for (;;) {
+        size_t offset = arena_push(&out_registry->source, PARSE_BLOCK_SIZE);
+        size_t num_read = fread(out_registry->source.memory + offset, 1, PARSE_BLOCK_SIZE, input);
+        out_registry->source.size = offset + num_read;
+        if (num_read < PARSE_BLOCK_SIZE) {
+            break;
+        }
+    }
+}
+
+/** @note this is useful since cygwin's compiler emulations do not ommit Windows' \r from line ending (neither does a mapped file on Windows) */
+#if defined(__CYGWIN__) || defined(_WIN32)
+#define line_trim_end(begin, end) \
+    ((end) > (begin) && (end)[-1] == '\r' ? (end) - 1 : (end))
+#else
+#define line_trim_end(begin, end) \
+    (end)
+#endif
+
+/** @brief a line of the registry source */
+typedef struct _Parse_Line {
+    const char* begin;
+    /** @brief the width is validated by the caller, the line may be longer than MAX_LINE_WIDTH */
+    size_t size;
+} Parse_Line;
+
+/**
+ * @brief finds the line beginning at the @param cursor (and moves the cursor behind it)
+ * @return 0 on success and 1 if there are no more lines
+ */
+inline static int _parse_next_line(const char** cursor, const char* end, OUT Parse_Line* out_line) {
+    const char* begin = *cursor;
+    if (begin >= end) {
+        return STR_FAIL;
+    }
+    const char* line_end = memchr(begin, '\n', (size_t)(end - begin));
+    *cursor = line_end != NULL ? line_end + 1 : end;
+    line_end = line_trim_end(begin, line_end != NULL ? line_end : end);
+    out_line->begin = begin;
+    out_line->size = (size_t)(line_end - begin);
+    return STR_SUCCESS;
+}
+
+inline static int _parse_is_number(const Parse_Line* line) {
+    for (size_t i = 0; i < line->size; i++) {
+        if (str_fail(char_is_number(line->begin[i]))) {
+            return STR_FAIL;
+        }
+    }
+    return STR_SUCCESS;
+}
+
+/**
+ * @brief fills the item @param index with the @param name and the @param number lines, precomputing everything the matching needs to know about it
+ * @note the t9 record of the item is put at the offset of its name line, it never reaches the next name line (the record is as long as both lines with their '\n')
+ */
+static void _parse_put_item(Phone_Registry* registry, Phone_Item_Index index, const Parse_Line* name, const Parse_Line* number) {
+    Phone_Item* item = registry_item(registry, index);
+    memset(item, 0, sizeof(Phone_Item));
+    Phone_Item_Text* text = registry_item_text(registry, index);
+    text->name = (Text_Offset)(name->begin - registry->text.memory);
+    item->name_size = (String_Index)name->size;
+    text->number = (Text_Offset)(number->begin - registry->text.memory);
+    item->number_size = (String_Index)number->size;
+    item->t9 = text->name;
+    t9_encode_number(number->begin, item->number_size, OUT item_t9_number(registry, item));
+    size_t readable = (size_t)(registry->source.memory + registry->source.size - name->begin);
+    kernels.encode_name(name->begin, item->name_size, readable, OUT item_t9_name(registry, item));
+    registry_signature(registry, index) = signature_make(digit_mask(item_t9_number(registry, item), item->number_size, 0),
+                                                         digit_mask(item_t9_name(registry, item), item->name_size, 0));
+}
+
+/** @brief the text registry is parsed by a single thread unless every thread (-j) gets at least this many bytes of it */
+#define PARSE_MIN_CHUNK_SIZE (1024 * 1024)
+
+typedef enum _Parse_Step {
+    /** @brief counts the lines of the chunk */
+    PARSE_STEP_COUNT,
+    /** @brief parses the items whose name line is in the chunk */
+    PARSE_STEP_ITEMS,
+} Parse_Step;
+
+/** @brief a part of the registry source beginning right after a '\n', parsed by one thread */
+typedef struct _Parse_Chunk {
+    Phone_Registry* registry;
+    const char* begin;
+    const char* end;
+    Parse_Step step;
+    /** @brief lines beginning inside of the chunk */
+    size_t num_lines;
+    /** @brief lines of the source before the chunk, if it is odd the first line of the chunk is the number of the item begun by the previous one */
+    size_t first_line;
+    /** @brief the first error of the chunk (in the order of the source) */
+    Error error;
+} Parse_Chunk;
+
+/** @brief 0x01 in every byte of a word */
+#define PARSE_WORD_ONES 0x0101010101010101ull
+/** @brief the per byte counts of _parse_count_newlines are summed up before any of them can overflow */
+#define PARSE_WORDS_PER_SUM 255
+
+/** @brief counts the '\n' between @param begin and @param end 8 bytes at a time (each byte of the word is compared with '\n' at once, counted in its own byte) */
+static size_t _parse_count_newlines(const char* begin, const char* end) {
+    const uint64_t low_bits = 0x7f * PARSE_WORD_ONES;
+    size_t count = 0;
+    while (end - begin >= 8) {
+        uint64_t counts = 0;
+        for (int w = 0; w < PARSE_WORDS_PER_SUM && end - begin >= 8; w++, begin += 8) {
+            uint64_t word;
+            memcpy(&word, begin, sizeof(word));
+            word ^= '\n' * PARSE_WORD_ONES;
+            // the high bit of a byte is set only if the byte is zero (the addition carries into it otherwise)
+            counts += ~(((word & low_bits) + low_bits) | word | low_bits) >> 7;
+        }
+        counts = (counts & 0x00ff00ff00ff00ffull) + ((counts >> 8) & 0x00ff00ff00ff00ffull);
+        count += (size_t)((counts * 0x0001000100010001ull) >> 48);
+    }
+    for (; begin < end; begin++) {
+        count += *begin == '\n';
+    }
+    return count;
+}
+
+static void _parse_count_lines(Parse_Chunk* chunk) {
+    size_t num_lines = _parse_count_newlines(chunk->begin, chunk->end);
+    // the last line of the source does not have to be terminated
+    chunk->num_lines = num_lines + (chunk->end > chunk->begin && chunk->end[-1] != '\n');
+}
+
+/**
+ * @brief parses the items of the @param chunk into their places, the item of its last name line may take its number from the next chunk
+ * @return the first error found in the chunk, validated the same way as the whole source would be line by line
+ */
+static Error _parse_items(const Parse_Chunk* chunk) {
+    Phone_Registry* registry = chunk->registry;
+    const char* cursor = chunk->begin;
+    const char* end = registry->text.memory + registry->text.size;
+    Parse_Line name = {0}, number = {0};
+    if (chunk->num_lines > 0 && chunk->first_line % 2 == 1) {
+        _parse_next_line(&cursor, end, OUT &number);
+    }
+    Phone_Item_Index index = (Phone_Item_Index)((chunk->first_line + 1) / 2);
+    while (cursor < chunk->end) {
+        _parse_next_line(&cursor, end, OUT &name);
+        if (name.size > MAX_LINE_WIDTH) {
+            return ERROR_LINE_TOO_LARGE;
+        }
+        if (str_fail(_parse_next_line(&cursor, end, OUT &number))) {
+            // only a trailing empty line is tolerated, it is not an item but its t9 bytes are zeroed as well
+            if (name.size > 0) {
+                return ERROR_FILE_SIZE_MISMATCH;
+            }
+            memset(registry->t9.memory + (name.begin - registry->text.memory), 0, (size_t)(end - name.begin));
+            break;
+        }
+        if (number.size > MAX_LINE_WIDTH) {
+            return ERROR_LINE_TOO_LARGE;
+        }
+        if (str_fail(_parse_is_number(&number))) {
+            return ERROR_INVALID_NUMBER;
+        }
+        _parse_put_item(registry, index++, &name, &number);
+        // the trimmed '\r' leave a gap up to the record of the next line, it is zeroed so that the image does not depend on garbage
+        size_t record_end = (size_t)(name.begin - registry->text.memory) + name.size + number.size + 2;
+        size_t next = (size_t)(cursor - registry->text.memory);
+        if (next > record_end) {
+            memset(registry->t9.memory + record_end, 0, next - record_end);
+        }
+    }
+    return ERROR_NONE;
+}
+
+static void _parse_run_step(Parse_Chunk* chunk) {
+    if (chunk->step == PARSE_STEP_COUNT) {
+        _parse_count_lines(chunk);
+    } else {
+        chunk->error = _parse_items(chunk);
+    }
+}
+
+static thread_routine(_parse_worker, arg) {
+    _parse_run_step((Parse_Chunk*)arg);
+    return THREAD_ROUTINE_RETURN;
+}
+
+/** @brief runs the @param step of all the @param chunks concurrently, the same way scan_parallel runs its tasks */
+static void _parse_parallel(Parse_Chunk* chunks, unsigned num_chunks, Parse_Step step) {
+    Thread threads[THREADS_MAX_COUNT];
+    int started[THREADS_MAX_COUNT];
+    for (unsigned t = 0; t < num_chunks; t++) {
+        chunks[t].step = step;
+    }
+    for (unsigned t = 1; t < num_chunks; t++) {
+        started[t] = str_success(thread_start(&threads[t], _parse_worker, &chunks[t]));
+    }
+    _parse_run_step(&chunks[0]);
+    for (unsigned t = 1; t < num_chunks; t++) {
+        if (started[t]) {
+            thread_join(threads[t]);
+        } else {
+            _parse_run_step(&chunks[t]);
+        }
+    }
+}
+
+/** @brief splits the text of the @param registry into (at most) @param num_threads chunks of about the same size, each one beginning at a line */
+static unsigned _parse_split(Phone_Registry* registry, unsigned num_threads, OUT Parse_Chunk* out_chunks) {
+    const char* text = registry->text.memory;
+    size_t size = registry->text.size;
+    unsigned num_chunks = num_threads > 0 ? num_threads : 1;
+    if (num_chunks > size / PARSE_MIN_CHUNK_SIZE) {
+        num_chunks = size / PARSE_MIN_CHUNK_SIZE > 0 ? (unsigned)(size / PARSE_MIN_CHUNK_SIZE) : 1;
+    }
+    const char* begin = text;
+    for (unsigned t = 0; t < num_chunks; t++) {
+        const char* end = text + size;
+        if (t + 1 < num_chunks) {
+            const char* split = text + size / num_chunks * (t + 1);
+            split = split > begin ? split : begin;
+            const char* line_end = memchr(split, '\n', (size_t)(text + size - split));
+            end = line_end != NULL ? line_end + 1 : text + size;
+        }
+        out_chunks[t] = (Parse_Chunk){ .registry = registry, .begin = begin, .end = end };
+        begin = end;
+    }
+    return num_chunks;
+}
+
+/**
+ * @brief scans the source of the @param out_registry for any Phone_Item(s), also validates the number being parsed
+ * @return the first error of the source (the same one a line by line parse stops at), ERROR_NONE if it is valid
+ * @note every name line has to be followed by a number line, only a trailing empty line is tolerated
+ * @note the source is split into a chunk per thread (@param num_threads), the lines of every chunk are counted first, so that each one knows where its items go and whether its first line belongs to the previous one
+ */
+static Error parse_file_contents(unsigned num_threads, OUT Phone_Registry* restrict out_registry) {
+    arena_borrow(&out_registry->text, out_registry->source.memory, out_registry->source.size);
+    Parse_Chunk chunks[THREADS_MAX_COUNT];
+    unsigned num_chunks = _parse_split(out_registry, num_threads, OUT chunks);
+    _parse_parallel(chunks, num_chunks, PARSE_STEP_COUNT);
+    size_t num_lines = 0;
+    for (unsigned t = 0; t < num_chunks; t++) {
+        chunks[t].first_line = num_lines;
+        num_lines += chunks[t].num_lines;
+    }
+    if (num_lines / 2 > PHONE_ITEM_INDEX_MAX_SIZE) {
+        return ERROR_FILE_TOO_LARGE;
+    }
+    out_registry->num_items = (Phone_Item_Index)(num_lines / 2);
+    arena_push(&out_registry->items, out_registry->num_items * sizeof(Phone_Item));
+    arena_push(&out_registry->item_texts, out_registry->num_items * sizeof(Phone_Item_Text));
+    arena_push(&out_registry->signatures, out_registry->num_items * sizeof(Item_Signature));
+    // every record is at the offset of its name line, the last one may end a byte behind the source, the kernels may read past it
+    size_t padding = arena_push(&out_registry->t9, out_registry->text.size + 1 + KERNEL_PADDING) + out_registry->text.size;
+    _parse_parallel(chunks, num_chunks, PARSE_STEP_ITEMS);
+    memset(out_registry->t9.memory + padding, 0, 1 + KERNEL_PADDING);
+    for (unsigned t = 0; t < num_chunks; t++) {
+        if (chunks[t].error != ERROR_NONE) {
+            return chunks[t].error;
+        }
+    }
+    return ERROR_NONE;
+}
+
+/**
+ * @brief folds the '+' of the typed @param phone onto '0' so that it can be compared with the t9_number(s)
+ * @note the raw keyboard input is used for the t9_name(s) instead, '+' is not typeable in a name
+ */
+static Sized_String t9_fold_phone(const Sized_String* phone) {
+    Sized_String folded = { .size = phone->size };
+    t9_encode_number(phone->string, phone->size, OUT folded.string);
+    return folded;
+}
+
+#ifdef DEBUG
+static void _debug_print_match(const char* field, const char* string, String_Index size, String_Index at, String_Index length) {
+    printf("%s matched at: %d\n%.*s\n", field, at, (int)size, string);
+    String ranged_string = {0};
+    for (String_Index k = 0; k < size; k++) {
+        ranged_string[k] = (k >= at && k < at + length) ? '^' : ' ';
+    }
+    printf("%s\n", ranged_string);
+}
+#endif
+
+/**
+ * @brief scans the param range of the param registry for matches of param phone, results are put inside param out_matches (or the param top if they are ranked)
+ */
+#ifdef DEBUG
+static void match(Sized_String phone, int debug_enabled, Phone_Registry* registry, Phone_Item_Range range, Match_Top* top, OUT Phone_Registry_View* out_matches) {
+#else
+static void match(Sized_String phone, Phone_Registry* registry, Phone_Item_Range range, Match_Top* top, OUT Phone_Registry_View* out_matches) {
+#endif
+    Sized_String t9_phone = t9_fold_phone(&phone);
+    Item_Signature query = signature_make(digit_mask(t9_phone.string, t9_phone.size, DIGIT_MASK_OTHER), digit_mask(phone.string, phone.size, DIGIT_MASK_OTHER));
+    const Item_Signature* signatures = arena_as(registry->signatures, Item_Signature);
+    Phone_Item_Index i = range.begin;
+    for (; i < range.end; i++) {
+        Item_Signature missing = signature_missing(signatures[i], query);
+        if (signature_rejects(missing)) {
+            continue;
+        }
+        Phone_Item* item = registry_item(registry, i);
+        if ((item->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        // check for number first (higher priority)
+        String_Index at = (missing & SIGNATURE_NUMBER) == 0 ? string_find(&t9_phone, item_t9_number(registry, item), item->number_size) : STRING_NOT_FOUND;
+        if (at != STRING_NOT_FOUND) {
+#ifdef DEBUG
+            if (debug_enabled) {
+                _debug_print_match("Number", item_number(registry, i), item->number_size, at, phone.size);
+            }
+#endif
+            if (str_fail(match_found(top, out_matches, MATCH_FIELD_NUMBER, at, i))) {
+                i++;
+                break;
+            }
+            continue;
+        }
+        // check for name if number was not a match
+        if ((missing & SIGNATURE_NAME) != 0) {
+            continue;
+        }
+        at = string_find(&phone, item_t9_name(registry, item), item->name_size);
+        if (at != STRING_NOT_FOUND) {
+#ifdef DEBUG
+            if (debug_enabled) {
+                _debug_print_match("Name", item_name(registry, i), item->name_size, at, phone.size);
+            }
+#endif
+            if (str_fail(match_found(top, out_matches, MATCH_FIELD_NAME, at, i))) {
+                i++;
+                break;
+            }
+        }
+    }
+    stats_local.entries += i - range.begin;
+}
+
+/* =========================================
+ *                  Index
+ * ========================================= */
+
+typedef uint32_t Index_Offset;
+
+/** @brief terminates every field of the indexed text, it is smaller than any of the keys and it can never be typed */
+#define INDEX_SEPARATOR '\0'
+#define INDEX_OFFSET_MAX_SIZE MAX_SIZE(Index_Offset)
+#define index_built(index) ((index)->suffixes.size > 0)
+
+inline static void _index_push_field(Suffix_Index* index, const char* field, String_Index size) {
+    Index_Offset offset = (Index_Offset)index->text.size;
+    arena_as(index->fields, Index_Offset)[index->fields.size / sizeof(Index_Offset)] = offset;
+    index->fields.size += sizeof(Index_Offset);
+    arena_push(&index->text, size + 1);
+    memcpy(index->text.memory + offset, field, size);
+    index->text.memory[offset + size] = INDEX_SEPARATOR;
+}
+
+/** @brief number of leading characters packed into a single sort key (4 bits per character) */
+#define INDEX_KEY_LENGTH 16
+
+/** @brief the keys are radix sorted by this many bits at a time */
+#define INDEX_RADIX_BITS 16
+#define INDEX_RADIX_MASK ((1u << INDEX_RADIX_BITS) - 1)
+
+typedef struct _Index_Key {
+    uint64_t key;
+    Index_Offset offset;
+} Index_Key;
+
+/** @brief packs the first INDEX_KEY_LENGTH characters of the suffix into an order preserving key, everything behind the separator is zeroed out */
+inline static uint64_t _index_key(const char* suffix) {
+    uint64_t key = 0;
+    String_Index i = 0;
+    for (; i < INDEX_KEY_LENGTH && suffix[i] != INDEX_SEPARATOR; i++) {
+        uint64_t symbol = (suffix[i] >= '0' && suffix[i] <= '9') ? (uint64_t)(suffix[i] - '0' + 1) : 11;
+        key = (key << 4) | symbol;
+    }
+    return key << (4 * (INDEX_KEY_LENGTH - i));
+}
+
+/** @brief the text the suffixes of the running sort belong to (qsort has no context argument), one per thread so that the shards can be indexed at once */
+static thread_local_storage const char* _index_sort_text = NULL;
+
+static int _index_compare_suffixes(const void* a, const void* b) {
+    const Index_Key* x = a;
+    const Index_Key* y = b;
+    // separator is '\0', so the fields are ordinary C strings
+    return strcmp(_index_sort_text + x->offset + INDEX_KEY_LENGTH, _index_sort_text + y->offset + INDEX_KEY_LENGTH);
+}
+
+/**
+ * @brief sorts the @param n @param keys lexicographically by their suffixes of the @param text
+ * @note LSD radix sort by the packed keys first, only the runs of suffixes sharing all of the INDEX_KEY_LENGTH characters are compared character by character afterwards
+ */
+static void _index_sort_suffixes(const char* text, size_t n, Index_Key* keys) {
+    Index_Key* swap = malloc(sizeof(Index_Key) * n);
+    or_exit(swap != NULL, ERROR_FILE_TOO_LARGE);
+    size_t* counts = malloc(sizeof(size_t) * (INDEX_RADIX_MASK + 1));
+    or_exit(counts != NULL, ERROR_FILE_TOO_LARGE);
+    Index_Key* from = keys;
+    Index_Key* to = swap;
+    for (unsigned shift = 0; shift < 64; shift += INDEX_RADIX_BITS) {
+        memset(counts, 0, sizeof(size_t) * (INDEX_RADIX_MASK + 1));
+        for (size_t i = 0; i < n; i++) {
+            counts[(from[i].key >> shift) & INDEX_RADIX_MASK]++;
+        }
+        if (counts[(from[0].key >> shift) & INDEX_RADIX_MASK] == n) {
+            continue; // every key shares this digit
+        }
+        size_t position = 0;
+        for (size_t b = 0; b <= INDEX_RADIX_MASK; b++) {
+            size_t count = counts[b];
+            counts[b] = position;
+            position += count;
+        }
+        for (size_t i = 0; i < n; i++) {
+            to[counts[(from[i].key >> shift) & INDEX_RADIX_MASK]++] = from[i];
+        }
+        Index_Key* temp = from; from = to; to = temp;
+    }
+    free(counts);
+    if (from != keys) {
+        memcpy(keys, from, sizeof(Index_Key) * n);
+    }
+    free(swap);
+
+    _index_sort_text = text;
+    for (size_t run = 0; run < n;) {
+        size_t run_end = run + 1;
+        while (run_end < n && keys[run_end].key == keys[run].key) {
+            run_end++;
+        }
+        // a key without the separator means that the suffixes go on past the packed characters
+        if (run_end - run > 1 && (keys[run].key & 0xF) != 0) {
+            qsort(&keys[run], run_end - run, sizeof(Index_Key), _index_compare_suffixes);
+        }
+        run = run_end;
+    }
+    _index_sort_text = NULL;
+}
+
+/**
+ * @brief builds the suffix array over the t9_number(s) and t9_name(s) of the @param registry
+ * @note text is padded by MAX_STR_LEN separators, so that any suffix can be compared with any keyboard input (or packed into a key) without bounds checks
+ */
+static void index_build(Phone_Registry* registry) {
+    Suffix_Index* index = &registry->index;
+    // an index without any suffix (of an empty registry) is not built yet, it is built again once the registry grows
+    index->text.size = 0;
+    index->suffixes.size = 0;
+    index->delta.size = 0;
+    arena_push(&index->fields, sizeof(Index_Offset) * ((size_t)registry->num_items * 2 + 1));
+    index->fields.size = 0;
+    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
+        Phone_Item* item = registry_item(registry, i);
+        _index_push_field(index, item_t9_number(registry, item), item->number_size);
+        _index_push_field(index, item_t9_name(registry, item), item->name_size);
+    }
+    size_t text_size = index->text.size;
+    or_exit(text_size < INDEX_OFFSET_MAX_SIZE - MAX_STR_LEN, ERROR_FILE_TOO_LARGE);
+    arena_as(index->fields, Index_Offset)[index->fields.size / sizeof(Index_Offset)] = (Index_Offset)text_size;
+    index->fields.size += sizeof(Index_Offset);
+    size_t padding = arena_push(&index->text, MAX_STR_LEN);
+    memset(index->text.memory + padding, INDEX_SEPARATOR, MAX_STR_LEN);
+
+    // separators can never be the beginning of a match, they are left out
+    size_t num_suffixes = text_size - (size_t)registry->num_items * 2;
+    if (num_suffixes == 0) {
+        return;
+    }
+    Index_Key* keys = malloc(sizeof(Index_Key) * num_suffixes);
+    or_exit(keys != NULL, ERROR_FILE_TOO_LARGE);
+    size_t num_keys = 0;
+    for (size_t i = 0; i < text_size; i++) {
+        if (index->text.memory[i] != INDEX_SEPARATOR) {
+            keys[num_keys].key = _index_key(index->text.memory + i);
+            keys[num_keys++].offset = (Index_Offset)i;
+        }
+    }
+    _index_sort_suffixes(index->text.memory, num_suffixes, keys);
+    arena_push(&index->suffixes, sizeof(Index_Offset) * num_suffixes);
+    Index_Offset* suffixes = arena_as(index->suffixes, Index_Offset);
+    for (size_t i = 0; i < num_suffixes; i++) {
+        suffixes[i] = keys[i].offset;
+    }
+    free(keys);
+}
+
+/** @brief finds the first suffix which is not smaller (@param upper == 0) or which is greater (@param upper == 1) than the @param phone */
+static size_t _index_bound(const Suffix_Index* index, const Sized_String* phone, int upper) {
+    const Index_Offset* suffixes = arena_as(index->suffixes, Index_Offset);
+    size_t low = 0, high = index->suffixes.size / sizeof(Index_Offset);
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = memcmp(index->text.memory + suffixes[mid], phone->string, phone->size);
+        if (cmp < 0 || (upper && cmp == 0)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static int _index_compare_fields(const void* a, const void* b) {
+    Index_Offset x = *(const Index_Offset*)a, y = *(const Index_Offset*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief same as match but looks the occurrences up in the suffix array, only the items which do match are touched
+ * @note the number and the name of an item are separate fields but the item is reported only once, and in the registry order as well
+ */
+static void match_indexed(Sized_String phone, Phone_Registry* restrict registry, OUT Phone_Registry_View* restrict out_matches) {
+    Suffix_Index* index = &registry->index;
+    if (!index_built(index) || phone.size == 0) {
+        return;
+    }
+    // '+' can be typed only in numbers, the name occurrences of the folded phone do not count then
+    int numbers_only = memchr(phone.string, '+', phone.size) != NULL;
+    Sized_String t9_phone = t9_fold_phone(&phone);
+    size_t begin = _index_bound(index, &t9_phone, 0);
+    size_t end = _index_bound(index, &t9_phone, 1);
+
+    Arena hits = {0};
+    const Index_Offset* suffixes = arena_as(index->suffixes, Index_Offset);
+    const Index_Offset* fields = arena_as(index->fields, Index_Offset);
+    size_t num_fields = index->fields.size / sizeof(Index_Offset) - 1;
+    // the suffixes of the deleted and the edited items may still be there (see Edit)
+    int edited = registry->ids.size > 0;
+    stats_local.candidates += end - begin;
+    for (size_t s = begin; s < end; s++) {
+        // the field the suffix belongs to is the last one starting before it
+        size_t low = 0, high = num_fields;
+        while (high - low > 1) {
+            size_t mid = low + (high - low) / 2;
+            if (fields[mid] <= suffixes[s]) {
+                low = mid;
+            } else {
+                high = mid;
+            }
+        }
+        if ((numbers_only && (low & 1)) || (edited && registry_item(registry, low / 2)->flags != 0)) {
+            continue;
+        }
+        size_t hit = arena_push(&hits, sizeof(Index_Offset));
+        *(Index_Offset*)(hits.memory + hit) = (Index_Offset)low;
+    }
+    // the items edited since the build are matched the same way as match does it
+    const Phone_Item_Index* delta = arena_as(index->delta, Phone_Item_Index);
+    size_t num_delta = index->delta.size / sizeof(Phone_Item_Index);
+    stats_local.candidates += num_delta;
+    for (size_t d = 0; d < num_delta; d++) {
+        Phone_Item* item = registry_item(registry, delta[d]);
+        size_t field = 2 * (size_t)delta[d];
+        if ((item->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        if (string_find(&t9_phone, item_t9_number(registry, item), item->number_size) == STRING_NOT_FOUND) {
+            if (numbers_only || string_find(&phone, item_t9_name(registry, item), item->name_size) == STRING_NOT_FOUND) {
+                continue;
+            }
+            field++;
+        }
+        size_t hit = arena_push(&hits, sizeof(Index_Offset));
+        *(Index_Offset*)(hits.memory + hit) = (Index_Offset)field;
+    }
+    // sorting the fields sorts the items as well, and the number of an item comes before its name
+    size_t num_hits = hits.size / sizeof(Index_Offset);
+    Index_Offset* hit_fields = arena_as(hits, Index_Offset);
+    if (num_hits > 0) {
+        qsort(hit_fields, num_hits, sizeof(Index_Offset), _index_compare_fields);
+    }
+    for (size_t h = 0; h < num_hits; h++) {
+        if (h == 0 || hit_fields[h] / 2 != hit_fields[h - 1] / 2) {
+            if (hit_fields[h] & 1) {
+                stats_local.hits_name++;
+            } else {
+                stats_local.hits_number++;
+            }
+            view_push(out_matches, (Phone_Item_Index)(hit_fields[h] / 2));
+        }
+    }
+    arena_free(&hits);
+}
+
+/* =========================================
+ *                Subsequence
+ * ========================================= */
+
+#define subsequence_built(subsequences) ((subsequences)->tables.size > 0)
+#define t9_key_index(c) ((c) - '0')
+#define is_t9_key(c) ((c) >= '0' && (c) <= '9')
+
+/**
+ * @brief fills the @param table_index -th table with the positions of the @param field, which are appended to the positions
+ * @note an updated field gets new positions, the old ones are left behind until registry_compact
+ */
+static void _subsequence_fill_table(Subsequence_Index* subsequences, size_t table_index, const char* field, String_Index size) {
+    Subsequence_Table* table = &arena_as(subsequences->tables, Subsequence_Table)[table_index];
+    memset(table, 0, sizeof(Subsequence_Table));
+    or_exit(subsequences->positions.size <= UINT32_MAX - MAX_STR_LEN, ERROR_FILE_TOO_LARGE);
+    table->base = (uint32_t)subsequences->positions.size;
+
+    String_Index counts[T9_NUM_KEYS + 1] = {0};
+    for (String_Index i = 0; i < size; i++) {
+        if (is_t9_key(field[i])) {
+            counts[t9_key_index(field[i]) + 1]++;
+        }
+    }
+    for (int k = 1; k <= T9_NUM_KEYS; k++) {
+        table->starts[k] = table->starts[k - 1] + counts[k];
+        counts[k] = table->starts[k];
+    }
+    counts[0] = 0;
+    size_t positions_offset = arena_push(&subsequences->positions, table->starts[T9_NUM_KEYS]);
+    String_Index* positions = (String_Index*)(subsequences->positions.memory + positions_offset);
+    for (String_Index i = 0; i < size; i++) {
+        if (is_t9_key(field[i])) {
+            positions[counts[t9_key_index(field[i])]++] = i;
+        }
+    }
+}
+
+static void _subsequence_push_field(Subsequence_Index* subsequences, const char* field, String_Index size) {
+    size_t table_offset = arena_push(&subsequences->tables, sizeof(Subsequence_Table));
+    _subsequence_fill_table(subsequences, table_offset / sizeof(Subsequence_Table), field, size);
+}
+
+/** @brief builds the position tables for the t9_number(s) and the t9_name(s) of the @param registry */
+static void subsequence_build(Phone_Registry* registry) {
+    Subsequence_Index* subsequences = &registry->subsequences;
+    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
+        Phone_Item* item = registry_item(registry, i);
+        _subsequence_push_field(subsequences, item_t9_number(registry, item), item->number_size);
+        _subsequence_push_field(subsequences, item_t9_name(registry, item), item->name_size);
+    }
+}
+
+/** @brief keyboard input prepared for the subsequence search */
+typedef struct _Subsequence_Query {
+    /** @brief keys of the input (0..9) */
+    String_Index keys[MAX_STR_LEN];
+    String_Index size;
+    /** @brief how many times each of the keys occurs in the input */
+    String_Index counts[T9_NUM_KEYS];
+} Subsequence_Query;
+
+static Subsequence_Query _subsequence_query(const Sized_String* t9_phone) {
+    Subsequence_Query query = { .size = t9_phone->size };
+    for (String_Index i = 0; i < t9_phone->size; i++) {
+        query.keys[i] = (String_Index)t9_key_index(t9_phone->string[i]);
+        query.counts[query.keys[i]]++;
+    }
+    return query;
+}
+
+/**
+ * @brief checks whether the @param query is a subsequence of the field described by the @param table
+ * @note the field is rejected right away if it does not contain enough of any key, otherwise every key of the query only has to find its first position after the previously matched one
+ */
+static int subsequence_search(const Subsequence_Query* restrict query, const Subsequence_Table* restrict table, const String_Index* restrict positions) {
+    stats_local.match_calls++;
+    for (int k = 0; k < T9_NUM_KEYS; k++) {
+        if (query->counts[k] > table->starts[k + 1] - table->starts[k]) {
+            return STR_FAIL;
+        }
+    }
+    positions += table->base;
+    // each of the cursors only ever moves forward, since the matched positions are ascending
+    String_Index cursors[T9_NUM_KEYS];
+    memcpy(cursors, table->starts, sizeof(cursors));
+    int last = -1;
+    for (String_Index i = 0; i < query->size; i++) {
+        String_Index key = query->keys[i];
+        String_Index cursor = cursors[key];
+        String_Index end = table->starts[key + 1];
+        while (cursor < end && positions[cursor] <= last) {
+            cursor++;
+        }
+        if (cursor == end) {
+            return STR_FAIL;
+        }
+        last = positions[cursor];
+        cursors[key] = cursor + 1;
+    }
+    return STR_SUCCESS;
+}
+
+/**
+ * @brief scans the param range of the param registry for items containing the param phone as a subsequence, results are put inside param out_matches (or the param top if they are ranked)
+ * @note an empty phone is a subsequence of anything, the position tables have to be built already (see subsequence_build)
+ */
+static void match_ex(Sized_String phone, Phone_Registry* restrict registry, Phone_Item_Range range, Match_Top* restrict top, OUT Phone_Registry_View* restrict out_matches) {
+    // '+' can be typed only in numbers
+    int numbers_only = memchr(phone.string, '+', phone.size) != NULL;
+    Sized_String t9_phone = t9_fold_phone(&phone);
+    Subsequence_Query query = _subsequence_query(&t9_phone);
+    const Subsequence_Table* tables = arena_as(registry->subsequences.tables, Subsequence_Table);
+    const String_Index* positions = arena_as(registry->subsequences.positions, String_Index);
+    // the name half of the keyboard input with '+' is never contained, see DIGIT_MASK_OTHER
+    Item_Signature query_signature = signature_make(digit_mask(t9_phone.string, t9_phone.size, DIGIT_MASK_OTHER), digit_mask(phone.string, phone.size, DIGIT_MASK_OTHER));
+    const Item_Signature* signatures = arena_as(registry->signatures, Item_Signature);
+    Phone_Item_Index i = range.begin;
+    for (; i < range.end; i++) {
+        Item_Signature missing = signature_missing(signatures[i], query_signature);
+        if (signature_rejects(missing)) {
+            continue;
+        }
+        int field = MATCH_FIELD_NUMBER;
+        const Subsequence_Table* table = &tables[2 * (size_t)i];
+        if ((missing & SIGNATURE_NUMBER) != 0 || str_fail(subsequence_search(&query, table, positions))) {
+            field = MATCH_FIELD_NAME;
+            table++;
+            if (numbers_only || (missing & SIGNATURE_NAME) != 0 || str_fail(subsequence_search(&query, table, positions))) {
+                continue;
+            }
+        }
+        // the tables of a deleted item are left as they were, the item is skipped only once it matches
+        if ((registry_item(registry, i)->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        // the greedy search starts at the first occurrence of the first key
+        String_Index at = query.size > 0 ? positions[table->base + table->starts[query.keys[0]]] : 0;
+        if (str_fail(match_found(top, out_matches, field, at, i))) {
+            i++;
+            break;
+        }
+    }
+    stats_local.entries += i - range.begin;
+}
+
+/* =========================================
+ *                   Fuzzy
+ * ========================================= */
+
+#define FUZZY_WORD_BITS 64
+#define FUZZY_MAX_WORDS ((MAX_STR_LEN + FUZZY_WORD_BITS - 1) / FUZZY_WORD_BITS)
+
+/** @brief keyboard input prepared for the bit-parallel edit distance (Myers), the keys are the rows of the dynamic programming matrix */
+typedef struct _Fuzzy_Query {
+    /** @brief bit i of the word w is set for the character c if the key 64 * w + i of the input is c (none is set for anything but the keys) */
+    uint64_t masks[256][FUZZY_MAX_WORDS];
+    String_Index size;
+    int num_words;
+    /** @brief the bit of the last key inside of the last word */
+    uint64_t last;
+} Fuzzy_Query;
+
+static void _fuzzy_query(const Sized_String* t9_phone, OUT Fuzzy_Query* out_query) {
+    memset(out_query->masks, 0, sizeof(out_query->masks));
+    out_query->size = t9_phone->size;
+    out_query->num_words = (t9_phone->size + FUZZY_WORD_BITS - 1) / FUZZY_WORD_BITS;
+    out_query->last = (uint64_t)1 << ((t9_phone->size - 1) % FUZZY_WORD_BITS);
+    for (String_Index i = 0; i < t9_phone->size; i++) {
+        out_query->masks[(unsigned char)t9_phone->string[i]][i / FUZZY_WORD_BITS] |= (uint64_t)1 << (i % FUZZY_WORD_BITS);
+    }
+}
+
+/**
+ * @brief advances one word (block of 64 rows) of the column by one character of the field
+ * @return the difference of the last row of the block between this column and the previous one (-1, 0 or 1), which is carried into the next block
+ */
+inline static int _fuzzy_advance(uint64_t* restrict positive, uint64_t* restrict negative, uint64_t equal, int carry, uint64_t last) {
+    uint64_t vertical = equal | *negative;
+    if (carry < 0) {
+        equal |= 1;
+    }
+    uint64_t horizontal = (((equal & *positive) + *positive) ^ *positive) | equal;
+    uint64_t horizontal_positive = *negative | ~(horizontal | *positive);
+    uint64_t horizontal_negative = *positive & horizontal;
+    int out = (horizontal_positive & last) ? 1 : (horizontal_negative & last) ? -1 : 0;
+    horizontal_positive <<= 1;
+    horizontal_negative <<= 1;
+    if (carry < 0) {
+        horizontal_negative |= 1;
+    } else if (carry > 0) {
+        horizontal_positive |= 1;
+    }
+    *positive = horizontal_negative | ~(vertical | horizontal_positive);
+    *negative = horizontal_positive & vertical;
+    return out;
+}
+
+/**
+ * @brief finds the smallest edit distance between the @param query and any substring of the @param field, the first substring which has it ends at @param out_end
+ * @note the first row of the matrix is all zeroes (an occurrence may begin anywhere), only the deltas of the columns are kept as bit vectors
+ */
+static String_Index fuzzy_distance(const Fuzzy_Query* restrict query, const char* restrict field, String_Index size, OUT String_Index* restrict out_end) {
+    stats_local.match_calls++;
+    if (query->num_words == 1) {
+        // the usual input fits into one word, nothing is carried between the blocks then
+        uint64_t positive = ~(uint64_t)0, negative = 0;
+        int score = query->size;
+        String_Index best = query->size;
+        *out_end = 0;
+        for (String_Index i = 0; i < size && best > 0; i++) {
+            uint64_t equal = query->masks[(unsigned char)field[i]][0];
+            uint64_t vertical = equal | negative;
+            uint64_t horizontal = (((equal & positive) + positive) ^ positive) | equal;
+            uint64_t horizontal_positive = negative | ~(horizontal | positive);
+            uint64_t horizontal_negative = positive & horizontal;
+            score += (int)((horizontal_positive & query->last) != 0) - (int)((horizontal_negative & query->last) != 0);
+            horizontal_positive <<= 1;
+            horizontal_negative <<= 1;
+            positive = horizontal_negative | ~(vertical | horizontal_positive);
+            negative = horizontal_positive & vertical;
+            if (score < best) {
+                best = (String_Index)score;
+                *out_end = i;
+            }
+        }
+        return best;
+    }
+    uint64_t positive[FUZZY_MAX_WORDS], negative[FUZZY_MAX_WORDS];
+    for (int w = 0; w < query->num_words; w++) {
+        positive[w] = ~(uint64_t)0;
+        negative[w] = 0;
+    }
+    int score = query->size;
+    String_Index best = query->size;
+    *out_end = 0;
+    for (String_Index i = 0; i < size && best > 0; i++) {
+        const uint64_t* equal = query->masks[(unsigned char)field[i]];
+        int carry = 0;
+        for (int w = 0; w + 1 < query->num_words; w++) {
+            carry = _fuzzy_advance(&positive[w], &negative[w], equal[w], carry, (uint64_t)1 << (FUZZY_WORD_BITS - 1));
+        }
+        score += _fuzzy_advance(&positive[query->num_words - 1], &negative[query->num_words - 1], equal[query->num_words - 1], carry, query->last);
+        if (score < best) {
+            best = (String_Index)score;
+            *out_end = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief scans the param range of the param registry for items containing the param phone with at most param max_errors typos, all of them are ranked into the param top by the distance (then as match ranks them)
+ * @note the number wins over the name if they are just as close, the position of a fuzzy occurrence is the one of its end
+ */
+static void match_fuzzy(Sized_String phone, String_Index max_errors, Phone_Registry* restrict registry, Phone_Item_Range range, Match_Top* restrict top) {
+    // '+' can be typed only in numbers
+    int numbers_only = memchr(phone.string, '+', phone.size) != NULL;
+    if (phone.size == 0) {
+        return;
+    }
+    Sized_String t9_phone = t9_fold_phone(&phone);
+    static thread_local_storage Fuzzy_Query query;
+    _fuzzy_query(&t9_phone, OUT &query);
+    Phone_Item_Index i = range.begin;
+    for (; i < range.end; i++) {
+        Phone_Item* item = registry_item(registry, i);
+        if ((item->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        int field = MATCH_FIELD_NUMBER;
+        String_Index end = 0, name_end = 0;
+        // the keys missing in a field too short are typos already
+        String_Index distance = item->number_size + max_errors >= phone.size ? fuzzy_distance(&query, item_t9_number(registry, item), item->number_size, OUT &end) : STRING_NOT_FOUND;
+        if (distance > 0 && !numbers_only && item->name_size + max_errors >= phone.size) {
+            String_Index name_distance = fuzzy_distance(&query, item_t9_name(registry, item), item->name_size, OUT &name_end);
+            if (name_distance < distance) {
+                distance = name_distance;
+                end = name_end;
+                field = MATCH_FIELD_NAME;
+            }
+        }
+        if (distance > max_errors) {
+            continue;
+        }
+        if (field == MATCH_FIELD_NUMBER) {
+            stats_local.hits_number++;
+        } else {
+            stats_local.hits_name++;
+        }
+        if (str_fail(match_top_push(top, match_rank_fuzzy(distance, field, end, i)))) {
+            i++;
+            break;
+        }
+    }
+    stats_local.entries += i - range.begin;
+}
+
+/* =========================================
+ *                   Scan
+ * ========================================= */
+
+/** @brief a registry is split between the threads only if each of them gets at least this many items */
+#define SCAN_MIN_CHUNK_ITEMS 4096
+
+/** @brief the linear scan of one chunk of the registry, every worker thread owns one */
+typedef struct _Scan_Task {
+    const Sys_Args* args;
+    Phone_Registry* registry;
+    Phone_Item_Range range;
+    /** @brief the matches of the range only, in the registry order */
+    Phone_Registry_View matches;
+    /** @brief the best ranked matches of the range instead, if they are limited (-l) or fuzzy (-e), see scan_rank_limit */
+    Match_Top top;
+    /** @brief stats_local of the worker thread which scanned the range */
+    Stats_Counters counters;
+} Scan_Task;
+
+/** @brief how many of the best ranked matches the scan keeps, the fuzzy matches are ranked even if they are not limited (-l), 0 keeps all of them unranked */
+inline static Phone_Item_Index scan_rank_limit(const Sys_Args* args) {
+    if (args->limit == 0 && args->max_errors > 0 && (args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) == 0) {
+        return PHONE_ITEM_INDEX_MAX_SIZE;
+    }
+    return args->limit;
+}
+
+/** @brief runs match_ex (-s), match_fuzzy (-e) or match over the range of the @param task */
+static void _scan_range(Scan_Task* task) {
+    const Sys_Args* args = task->args;
+    Match_Top* top = task->top.limit > 0 ? &task->top : NULL;
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) > 0) {
+        match_ex(args->keyboard_input, task->registry, task->range, top, &task->matches);
+        return;
+    }
+    if (args->max_errors > 0) {
+        match_fuzzy(args->keyboard_input, args->max_errors, task->registry, task->range, top);
+        return;
+    }
+#ifdef DEBUG
+    match(args->keyboard_input, args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG, task->registry, task->range, top, &task->matches);
+#else
+    match(args->keyboard_input, task->registry, task->range, top, &task->matches);
+#endif
+}
+
+static thread_routine(_scan_worker, arg) {
+    Scan_Task* task = (Scan_Task*)arg;
+    _scan_range(task);
+    task->counters = stats_local;
+    return THREAD_ROUTINE_RETURN;
+}
+
+/**
+ * @brief splits the registry into one contiguous chunk per thread, scans them concurrently and concatenates the matches of the chunks in their order
+ * @note the chunks are consecutive, so the result is the same (and in the same order) as the one of a single-threaded scan
+ */
+static void scan_parallel(const Sys_Args* restrict args, Phone_Registry* restrict registry, unsigned num_threads, OUT Phone_Registry_View* restrict out_matches) {
+    Scan_Task tasks[THREADS_MAX_COUNT];
+    Thread threads[THREADS_MAX_COUNT];
+    int started[THREADS_MAX_COUNT];
+
+    Phone_Item_Index chunk = registry->num_items / num_threads;
+    Phone_Item_Index remainder = registry->num_items % num_threads;
+    Phone_Item_Index begin = 0;
+    for (unsigned t = 0; t < num_threads; t++) {
+        Phone_Item_Index size = chunk + (t < remainder);
+        tasks[t] = (Scan_Task){ .args = args, .registry = registry, .range = { begin, begin + size }, .top = { .limit = scan_rank_limit(args) } };
+        begin += size;
+    }
+    // the calling thread takes the first chunk itself, a chunk whose thread could not be created is scanned here as well
+    for (unsigned t = 1; t < num_threads; t++) {
+        started[t] = str_success(thread_start(&threads[t], _scan_worker, &tasks[t]));
+    }
+    _scan_range(&tasks[0]);
+    size_t num_matches = tasks[0].matches.num_indexes;
+    for (unsigned t = 1; t < num_threads; t++) {
+        if (started[t]) {
+            thread_join(threads[t]);
+            stats_merge(&tasks[t].counters);
+        } else {
+            _scan_range(&tasks[t]);
+        }
+        num_matches += tasks[t].matches.num_indexes;
+    }
+
+    if (tasks[0].top.limit > 0) {
+        // the best ranks of the whole registry are among the best ranks of the chunks
+        Match_Top top = { .limit = tasks[0].top.limit };
+        for (unsigned t = 0; t < num_threads; t++) {
+            for (Phone_Item_Index i = 0; i < tasks[t].top.size; i++) {
+                match_top_push(&top, match_top_rank(&tasks[t].top, i));
+            }
+            arena_free(&tasks[t].top.heap);
+        }
+        match_top_drain(&top, out_matches);
+        arena_free(&top.heap);
+        return;
+    }
+    size_t offset = arena_push(&out_matches->indexes, num_matches * sizeof(Phone_Item_Index));
+    for (unsigned t = 0; t < num_threads; t++) {
+        size_t size = tasks[t].matches.num_indexes * sizeof(Phone_Item_Index);
+        if (size > 0) {
+            memcpy(out_matches->indexes.memory + offset, tasks[t].matches.indexes.memory, size);
+        }
+        offset += size;
+        arena_free(&tasks[t].matches.indexes);
+    }
+    out_matches->num_indexes += (Phone_Item_Index)num_matches;
+}
+
+/**
+ * @brief keeps only the best ranked (-l) of the @param matches found without ranking, they are appended to the @param out_matches from the best one
+ * @note the occurrences are looked up again, the same way match does it
+ */
+static void rank_matches(const Sys_Args* restrict args, Phone_Registry* restrict registry, const Phone_Registry_View* restrict matches, OUT Phone_Registry_View* restrict out_matches) {
+    Match_Top top = { .limit = args->limit };
+    Sized_String t9_phone = t9_fold_phone(&args->keyboard_input);
+    for (Phone_Item_Index i = 0; i < matches->num_indexes; i++) {
+        Phone_Item_Index index = view_index(matches, i);
+        Phone_Item* item = registry_item(registry, index);
+        int field = MATCH_FIELD_NUMBER;
+        String_Index at = string_find(&t9_phone, item_t9_number(registry, item), item->number_size);
+        if (at == STRING_NOT_FOUND) {
+            field = MATCH_FIELD_NAME;
+            at = string_find(&args->keyboard_input, item_t9_name(registry, item), item->name_size);
+        }
+        // the matches are in the registry order, so the same stop condition holds
+        if (str_fail(match_top_push(&top, match_rank(field, at, index)))) {
+            break;
+        }
+    }
+    match_top_drain(&top, out_matches);
+    arena_free(&top.heap);
+}
+
+static void _registry_match(const Sys_Args* restrict args, Phone_Registry* restrict registry, OUT Phone_Registry_View* restrict out_matches) {
+    // the number itself is not set, meaning we can copy everything and return immedeatly
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0) {
+        // note: we could set a special index to signify that we want to print everything, but is it worth it ??
+        // all of them are ranked the same, the first ones are the best then
+        Phone_Item_Index num_listed = args->limit > 0 ? args->limit : registry->num_items;
+        for (Phone_Item_Index i = 0; i < registry->num_items && num_listed > 0; i++) {
+            if ((registry_item(registry, i)->flags & ITEM_FLAG_TOMBSTONE) == 0) {
+                view_push(out_matches, i);
+                num_listed--;
+            }
+        }
+        return;
+    }
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) == 0 && (args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_INDEX) > 0) {
+        // the lookup touches only the matching items, there is nothing to split
+        if (args->limit == 0) {
+            match_indexed(args->keyboard_input, registry, out_matches);
+            return;
+        }
+        Phone_Registry_View matches = { 0 };
+        match_indexed(args->keyboard_input, registry, &matches);
+        rank_matches(args, registry, &matches, out_matches);
+        arena_free(&matches.indexes);
+        return;
+    }
+    unsigned num_threads = args->num_threads > 0 ? args->num_threads : 1;
+    if (num_threads > registry->num_items / SCAN_MIN_CHUNK_ITEMS) {
+        num_threads = registry->num_items / SCAN_MIN_CHUNK_ITEMS;
+    }
+#ifdef DEBUG
+    // the debug output of the threads would interleave
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG) > 0) {
+        num_threads = 1;
+    }
+#endif
+    if (num_threads > 1) {
+        scan_parallel(args, registry, num_threads, out_matches);
+        return;
+    }
+    Scan_Task task = { .args = args, .registry = registry, .range = { 0, registry->num_items }, .matches = *out_matches, .top = { .limit = scan_rank_limit(args) } };
+    _scan_range(&task);
+    match_top_drain(&task.top, &task.matches);
+    arena_free(&task.top.heap);
+    *out_matches = task.matches;
+}
+
+/** @brief builds whatever the search of the @param args needs and is not built yet, the position tables are built before any of the threads could need them */
+static void registry_prepare(const Sys_Args* restrict args, Phone_Registry* restrict registry) {
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0) {
+        return;
+    }
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) > 0) {
+        if (!subsequence_built(&registry->subsequences)) {
+            subsequence_build(registry);
+        }
+    } else if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_INDEX) > 0) {
+        if (!index_built(&registry->index)) {
+            index_build(registry);
+        }
+    }
+}
+
+static void registry_match(const Sys_Args* restrict args, Phone_Registry* restrict registry, OUT Phone_Registry_View* restrict out_matches) {
+    uint64_t begin = stats_begin();
+    registry_prepare(args, registry);
+    stats_end(STATS_PHASE_BUILD, begin);
+    begin = stats_begin();
+    _registry_match(args, registry, out_matches);
+    stats_end(STATS_PHASE_MATCH, begin);
+    if (stats.enabled) {
+        stats.queries++;
+    }
+}
+
+/** @brief the size of the line format_fields makes of a match */
+#define fields_line_size(name_size, number_size) ((size_t)(name_size) + (number_size) + 3)
+
+/** @brief formats the @param name and the @param number of a match as "name, number" into the @param line (see fields_line_size) */
+inline static void format_fields(char* line, const char* name, String_Index name_size, const char* number, String_Index number_size) {
+    memcpy(line, name, name_size);
+    line += name_size;
+    *line++ = ',';
+    *line++ = ' ';
+    memcpy(line, number, number_size);
+    line[number_size] = '\n';
+}
+
+/** @brief prints the @param name and the @param number of a match, see format_fields */
+inline static void print_fields(Output_Writer* restrict writer, const char* name, String_Index name_size, const char* number, String_Index number_size) {
+    format_fields(output_reserve(writer, fields_line_size(name_size, number_size)), name, name_size, number, number_size);
+}
+
+/** @brief prints the item @param index of the @param registry, see print_fields */
+inline static void print_match(Output_Writer* restrict writer, Phone_Registry* restrict registry, Phone_Item_Index index) {
+    const Phone_Item* item = registry_item(registry, index);
+    print_fields(writer, item_name(registry, index), item->name_size, item_number(registry, index), item->number_size);
+}
+
+#define NOT_FOUND_MESSAGE "Not found\n"
+
+/**
+ * @brief for a give @param of registry, prints all the Phone_Items according to the mapping of @param registry_view into the @param writer
+ */
+inline static void print_matches(Output_Writer* restrict writer, Phone_Registry* restrict registry, Phone_Registry_View* restrict registry_view) {
+    if (registry_view->num_indexes == 0) {
+        output_write(writer, NOT_FOUND_MESSAGE, sizeof(NOT_FOUND_MESSAGE) - 1);
+        return;
+    }
+    for (Phone_Item_Index i = 0; i < registry_view->num_indexes; i++) {
+        print_match(writer, registry, view_index(registry_view, i));
+    }
+}
+
+/* =========================================
+ *                 Automaton
+ * ========================================= */
+
+#define AUTOMATON_ROOT 0
+#define AUTOMATON_NONE UINT32_MAX
+
+/** @brief anything but the keys '0'..'9' (the T9_NO_KEY of a name) leads back to the root through this edge, the key k takes the edge k + 1 */
+#define AUTOMATON_OTHER 0
+
+static const uint8_t automaton_edges[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+};
+
+/** @brief one state of the automaton, the trie node of a prefix of some of the queries */
+typedef struct _Automaton_Node {
+    /** @brief the next state for every edge (see automaton_edges), the missing trie edges are completed along the failure links */
+    uint32_t next[T9_NUM_KEYS + 1];
+    /** @brief the state of the longest proper suffix of this one which is a prefix of some query */
+    uint32_t fail;
+    /** @brief the nearest state on the failure chain (this one excluded) where some query ends, AUTOMATON_NONE if there is none */
+    uint32_t dictionary;
+    /** @brief this state if some query ends in it, its dictionary state otherwise */
+    uint32_t output;
+    /** @brief the first query ending in this state, the others follow through Automaton_Query.next_same */
+    uint32_t first_query;
+} Automaton_Node;
+
+/** @brief one query of the automaton and its matches */
+typedef struct _Automaton_Query {
+    String_Index size;
+    /** @brief '+' can be typed only in numbers, the query is not looked for in the names then */
+    int numbers_only;
+    /** @brief the next query ending in the same state (the same folded phone) */
+    uint32_t next_same;
+    /** @brief 1 + the index of the last item the query was reported for, every item is reported once */
+    Phone_Item_Index reported;
+    /** @brief the top of the ranked query (-l) is full of unbeatable ranks, see match_top_push */
+    int done;
+    Phone_Registry_View matches;
+    Match_Top top;
+} Automaton_Query;
+
+/**
+ * @brief Aho-Corasick automaton over the folded keyboard inputs of many queries
+ * @note every field of the registry is streamed through it once, all the queries are matched at the same time
+ */
+typedef struct _Query_Automaton {
+    /** @brief Automaton_Node(s), the root is the first one */
+    Arena nodes;
+    /** @brief Automaton_Query(s) in the order they were added */
+    Arena queries;
+    uint32_t num_queries;
+} Query_Automaton;
+
+#define automaton_node(automaton, i) (&arena_as((automaton)->nodes, Automaton_Node)[(i)])
+#define automaton_query(automaton, i) (&arena_as((automaton)->queries, Automaton_Query)[(i)])
+
+static uint32_t _automaton_push_node(Query_Automaton* automaton) {
+    size_t offset = arena_push(&automaton->nodes, sizeof(Automaton_Node));
+    Automaton_Node* node = (Automaton_Node*)(automaton->nodes.memory + offset);
+    memset(node, 0, sizeof(Automaton_Node));
+    node->dictionary = AUTOMATON_NONE;
+    node->output = AUTOMATON_NONE;
+    node->first_query = AUTOMATON_NONE;
+    return (uint32_t)(offset / sizeof(Automaton_Node));
+}
+
+/**
+ * @brief adds the keyboard input @param phone to the trie of the @param automaton, ranked by the @param limit (-l) if it is not 0
+ * @return index of the query
+ */
+static uint32_t automaton_add(Query_Automaton* automaton, const Sized_String* phone, Phone_Item_Index limit) {
+    if (automaton->nodes.size == 0) {
+        _automaton_push_node(automaton);
+    }
+    Sized_String t9_phone = t9_fold_phone(phone);
+    uint32_t state = AUTOMATON_ROOT;
+    for (String_Index i = 0; i < t9_phone.size; i++) {
+        int key = automaton_edges[(unsigned char)t9_phone.string[i]];
+        // the root is never the target of a trie edge, 0 is a missing one until automaton_build
+        if (automaton_node(automaton, state)->next[key] == AUTOMATON_ROOT) {
+            uint32_t child = _automaton_push_node(automaton);
+            automaton_node(automaton, state)->next[key] = child;
+        }
+        state = automaton_node(automaton, state)->next[key];
+    }
+    size_t offset = arena_push(&automaton->queries, sizeof(Automaton_Query));
+    Automaton_Query* query = (Automaton_Query*)(automaton->queries.memory + offset);
+    memset(query, 0, sizeof(Automaton_Query));
+    query->size = phone->size;
+    query->numbers_only = memchr(phone->string, '+', phone->size) != NULL;
+    query->top.limit = limit;
+    query->next_same = automaton_node(automaton, state)->first_query;
+    automaton_node(automaton, state)->first_query = automaton->num_queries;
+    return automaton->num_queries++;
+}
+
+/** @brief computes the failure and the dictionary links breadth first and completes the transitions with them */
+static void automaton_build(Query_Automaton* automaton) {
+    size_t num_nodes = automaton->nodes.size / sizeof(Automaton_Node);
+    uint32_t* queue = malloc(sizeof(uint32_t) * num_nodes);
+    or_exit(queue != NULL, ERROR_FILE_TOO_LARGE);
+    size_t head = 0, tail = 0;
+    // the missing edges of the root lead back to the root (0), its children fail to it as well
+    Automaton_Node* root = automaton_node(automaton, AUTOMATON_ROOT);
+    for (int key = 1; key <= T9_NUM_KEYS; key++) {
+        if (root->next[key] != AUTOMATON_ROOT) {
+            queue[tail++] = root->next[key];
+        }
+    }
+    root->output = root->first_query;
+    while (head < tail) {
+        uint32_t state = queue[head++];
+        Automaton_Node* node = automaton_node(automaton, state);
+        Automaton_Node* fail = automaton_node(automaton, node->fail);
+        node->dictionary = fail->first_query != AUTOMATON_NONE ? node->fail : fail->dictionary;
+        node->output = node->first_query != AUTOMATON_NONE ? state : node->dictionary;
+        for (int key = 1; key <= T9_NUM_KEYS; key++) {
+            uint32_t child = node->next[key];
+            if (child == AUTOMATON_ROOT) {
+                node->next[key] = fail->next[key];
+                continue;
+            }
+            // the transitions of the failure state are complete already, it is closer to the root
+            automaton_node(automaton, child)->fail = fail->next[key];
+            queue[tail++] = child;
+        }
+    }
+    free(queue);
+}
+
+/**
+ * @brief streams the @param field of the item @param index through the automaton, every query ending at any position is reported (once per item) at its first occurrence
+ * @note the occurrences are found in the order of their ends, for a query of a given length that is the order of their beginnings as well
+ */
+static void _automaton_feed(Query_Automaton* restrict automaton, const char* restrict field, String_Index size, int field_kind, Phone_Item_Index index) {
+    const Automaton_Node* nodes = arena_as(automaton->nodes, Automaton_Node);
+    uint32_t state = AUTOMATON_ROOT;
+    for (String_Index i = 0; i < size; i++) {
+        state = nodes[state].next[automaton_edges[(unsigned char)field[i]]];
+        for (uint32_t output = nodes[state].output; output != AUTOMATON_NONE; output = nodes[output].dictionary) {
+            for (uint32_t q = nodes[output].first_query; q != AUTOMATON_NONE; q = automaton_query(automaton, q)->next_same) {
+                Automaton_Query* query = automaton_query(automaton, q);
+                if (query->reported == index + 1 || query->done || (field_kind == MATCH_FIELD_NAME && query->numbers_only)) {
+                    continue;
+                }
+                query->reported = index + 1;
+                Match_Top* top = query->top.limit > 0 ? &query->top : NULL;
+                query->done = str_fail(match_found(top, &query->matches, field_kind, (String_Index)(i + 1 - query->size), index));
+            }
+        }
+    }
+}
+
+/**
+ * @brief matches all the queries of the @param automaton against the @param registry in one pass, the matches of each one are the same as the ones of match
+ * @note the number of an item is fed before its name, so a query found in both is reported for the number
+ */
+static void automaton_match(Query_Automaton* restrict automaton, Phone_Registry* restrict registry) {
+    automaton_build(automaton);
+    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
+        Phone_Item* item = registry_item(registry, i);
+        if ((item->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        _automaton_feed(automaton, item_t9_number(registry, item), item->number_size, MATCH_FIELD_NUMBER, i);
+        _automaton_feed(automaton, item_t9_name(registry, item), item->name_size, MATCH_FIELD_NAME, i);
+    }
+    stats_local.entries += registry->num_items;
+    for (uint32_t q = 0; q < automaton->num_queries; q++) {
+        match_top_drain(&automaton_query(automaton, q)->top, &automaton_query(automaton, q)->matches);
+    }
+}
+
+/** @brief removes all the queries (and their matches), the memory is kept for the next ones */
+static void automaton_clear(Query_Automaton* automaton) {
+    for (uint32_t q = 0; q < automaton->num_queries; q++) {
+        arena_free(&automaton_query(automaton, q)->matches.indexes);
+        arena_free(&automaton_query(automaton, q)->top.heap);
+    }
+    automaton->nodes.size = 0;
+    automaton->queries.size = 0;
+    automaton->num_queries = 0;
+}
+
+static void automaton_free(Query_Automaton* automaton) {
+    automaton_clear(automaton);
+    arena_free(&automaton->nodes);
+    arena_free(&automaton->queries);
+}
+
+/* =========================================
+ *                   Image
+ * ========================================= */
+
+#define IMAGE_MAGIC "TNINEIMG"
+#define IMAGE_MAGIC_SIZE (sizeof(IMAGE_MAGIC) - 1)
+/** @brief has to be bumped whenever the layout of anything stored in the image changes */
+#define IMAGE_VERSION 4
+/** @brief stored as is, so that an image of a machine with different endianness is refused */
+#define IMAGE_BYTE_ORDER 0x01020304u
+/** @brief every section begins at a multiple of this (the mapping itself is page aligned) */
+#define IMAGE_ALIGNMENT 64
+#define IMAGE_NUM_SECTIONS 10
+
+typedef struct _Image_Section {
+    uint64_t offset;
+    uint64_t size;
+} Image_Section;
+
+/** @brief the image is this header followed by the sections, each one is the exact copy of an arena of the registry */
+typedef struct _Image_Header {
+    char magic[IMAGE_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t item_size;
+    uint32_t item_text_size;
+    uint32_t table_size;
+    uint64_t num_items;
+    Image_Section sections[IMAGE_NUM_SECTIONS];
+} Image_Header;
+
+/** @brief the arenas of the @param registry in the order of the image sections */
+static void _image_sections(Phone_Registry* registry, OUT Arena* out_sections[IMAGE_NUM_SECTIONS]) {
+    out_sections[0] = &registry->items;
+    out_sections[1] = &registry->item_texts;
+    out_sections[2] = &registry->signatures;
+    out_sections[3] = &registry->text;
+    out_sections[4] = &registry->t9;
+    out_sections[5] = &registry->index.text;
+    out_sections[6] = &registry->index.suffixes;
+    out_sections[7] = &registry->index.fields;
+    out_sections[8] = &registry->subsequences.tables;
+    out_sections[9] = &registry->subsequences.positions;
+}
+
+inline static void _image_write(FILE* image, const void* data, size_t size) {
+    or_exit(size == 0 || fwrite(data, 1, size, image) == size, ERROR_FILE_WRITE);
+}
+
+/**
+ * @brief writes the @param registry together with all of its indexes (which are built here if needed) into the image at @param path
+ * @note the image can then be used in place of the text registry, it is mapped without any parsing
+ */
+static void image_compile(Phone_Registry* registry, const char* path) {
+    if (!index_built(&registry->index)) {
+        index_build(registry);
+    }
+    if (!subsequence_built(&registry->subsequences)) {
+        subsequence_build(registry);
+    }
+    FILE* image = fopen(path, "wb");
+    or_exit(image != NULL, ERROR_FILE_OPEN);
+
+    Image_Header header = {
+        .version = IMAGE_VERSION,
+        .byte_order = IMAGE_BYTE_ORDER,
+        .item_size = sizeof(Phone_Item),
+        .item_text_size = sizeof(Phone_Item_Text),
+        .table_size = sizeof(Subsequence_Table),
+        .num_items = registry->num_items,
+    };
+    memcpy(header.magic, IMAGE_MAGIC, IMAGE_MAGIC_SIZE);
+    Arena* sections[IMAGE_NUM_SECTIONS];
+    _image_sections(registry, OUT sections);
+    uint64_t offset = sizeof(Image_Header);
+    for (int i = 0; i < IMAGE_NUM_SECTIONS; i++) {
+        offset = (offset + IMAGE_ALIGNMENT - 1) / IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+        header.sections[i].offset = offset;
+        header.sections[i].size = sections[i]->size;
+        offset += sections[i]->size;
+    }
+
+    static const char padding[IMAGE_ALIGNMENT] = {0};
+    _image_write(image, &header, sizeof(Image_Header));
+    uint64_t written = sizeof(Image_Header);
+    for (int i = 0; i < IMAGE_NUM_SECTIONS; i++) {
+        _image_write(image, padding, (size_t)(header.sections[i].offset - written));
+        _image_write(image, sections[i]->memory, sections[i]->size);
+        written = header.sections[i].offset + header.sections[i].size;
+    }
+    or_exit(fclose(image) == 0, ERROR_FILE_WRITE);
+}
+
+/**
+ * @brief checks that every offset stored in the image of the @param registry stays inside of the arena it points into
+ * @return ERROR_INVALID_IMAGE if any of them does not, the searches would read past the image otherwise
+ * @note a single pass over the items, the tables and the suffixes, nothing is built
+ */
+static Error _image_check(const Phone_Registry* registry) {
+    size_t num_items = registry->num_items;
+    for (size_t i = 0; i < num_items; i++) {
+        const Phone_Item* item = &arena_as(registry->items, Phone_Item)[i];
+        const Phone_Item_Text* item_text = &arena_as(registry->item_texts, Phone_Item_Text)[i];
+        // the kernels read up to KERNEL_PADDING bytes past the name (see Phone_Registry.t9)
+        size_t t9_size = (size_t)item->number_size + item->name_size + 2 + KERNEL_PADDING;
+        if (item->number_size > MAX_LINE_WIDTH || item->name_size > MAX_LINE_WIDTH ||
+            item->t9 > registry->t9.size || t9_size > registry->t9.size - item->t9 ||
+            item_text->name > registry->text.size || item->name_size > registry->text.size - item_text->name ||
+            item_text->number > registry->text.size || item->number_size > registry->text.size - item_text->number) {
+            return ERROR_INVALID_IMAGE;
+        }
+    }
+
+    const Subsequence_Index* subsequences = &registry->subsequences;
+    if (subsequences->tables.size != 0 && subsequences->tables.size != 2 * num_items * sizeof(Subsequence_Table)) {
+        return ERROR_INVALID_IMAGE;
+    }
+    for (size_t t = 0; t < subsequences->tables.size / sizeof(Subsequence_Table); t++) {
+        const Subsequence_Table* table = &arena_as(subsequences->tables, Subsequence_Table)[t];
+        const Phone_Item* item = &arena_as(registry->items, Phone_Item)[t / 2];
+        String_Index field_size = (t & 1) ? item->name_size : item->number_size;
+        if (table->starts[0] != 0 || table->starts[T9_NUM_KEYS] > field_size ||
+            table->base > subsequences->positions.size || table->starts[T9_NUM_KEYS] > subsequences->positions.size - table->base) {
+            return ERROR_INVALID_IMAGE;
+        }
+        for (int k = 0; k < T9_NUM_KEYS; k++) {
+            if (table->starts[k] > table->starts[k + 1]) {
+                return ERROR_INVALID_IMAGE;
+            }
+        }
+    }
+
+    const Suffix_Index* index = &registry->index;
+    if (!index_built(index)) {
+        return ERROR_NONE;
+    }
+    if (index->suffixes.size % sizeof(Index_Offset) != 0 || index->fields.size != (2 * num_items + 1) * sizeof(Index_Offset)) {
+        return ERROR_INVALID_IMAGE;
+    }
+    // any suffix is compared with up to MAX_STR_LEN characters, the text is padded by as many separators (see index_build)
+    const Index_Offset* fields = arena_as(index->fields, Index_Offset);
+    size_t text_size = fields[2 * num_items];
+    if (fields[0] != 0 || index->text.size < MAX_STR_LEN || text_size > index->text.size - MAX_STR_LEN) {
+        return ERROR_INVALID_IMAGE;
+    }
+    for (size_t f = 0; f < 2 * num_items; f++) {
+        if (fields[f] > fields[f + 1]) {
+            return ERROR_INVALID_IMAGE;
+        }
+    }
+    const Index_Offset* suffixes = arena_as(index->suffixes, Index_Offset);
+    for (size_t s = 0; s < index->suffixes.size / sizeof(Index_Offset); s++) {
+        if (suffixes[s] >= text_size) {
+            return ERROR_INVALID_IMAGE;
+        }
+    }
+    return ERROR_NONE;
+}
+
+/**
+ * @brief loads the @param out_registry from its source if the source is an image
+ * @return ERROR_INVALID_IMAGE if the image is damaged, @param out_loaded is 0 if the source is not an image (it has to be parsed as text)
+ * @note all of the arenas only borrow the source, nothing is copied, the offsets stored in them are checked though (see _image_check)
+ */
+static Error image_load(OUT Phone_Registry* restrict out_registry, OUT int* restrict out_loaded) {
+    const Arena* source = &out_registry->source;
+    if (source->size < IMAGE_MAGIC_SIZE || memcmp(source->memory, IMAGE_MAGIC, IMAGE_MAGIC_SIZE) != 0) {
+        *out_loaded = 0;
+        return ERROR_NONE;
+    }
+    *out_loaded = 1;
+
+    Image_Header header;
+    if (source->size < sizeof(Image_Header)) {
+        return ERROR_INVALID_IMAGE;
+    }
+    memcpy(&header, source->memory, sizeof(Image_Header));
+    if (header.version != IMAGE_VERSION || header.byte_order != IMAGE_BYTE_ORDER ||
+        header.item_size != sizeof(Phone_Item) || header.item_text_size != sizeof(Phone_Item_Text) || header.table_size != sizeof(Subsequence_Table) ||
+        header.num_items > PHONE_ITEM_INDEX_MAX_SIZE) {
+        return ERROR_INVALID_IMAGE;
+    }
+    Arena* sections[IMAGE_NUM_SECTIONS];
+    _image_sections(out_registry, OUT sections);
+    for (int i = 0; i < IMAGE_NUM_SECTIONS; i++) {
+        Image_Section section = header.sections[i];
+        if (section.offset % IMAGE_ALIGNMENT != 0 || section.offset > source->size || section.size > source->size - section.offset) {
+            return ERROR_INVALID_IMAGE;
+        }
+        arena_borrow(sections[i], source->memory + section.offset, (size_t)section.size);
+    }
+    if (out_registry->items.size != header.num_items * sizeof(Phone_Item) ||
+        out_registry->item_texts.size != header.num_items * sizeof(Phone_Item_Text) ||
+        out_registry->signatures.size != header.num_items * sizeof(Item_Signature)) {
+        return ERROR_INVALID_IMAGE;
+    }
+    out_registry->num_items = (Phone_Item_Index)header.num_items;
+    return _image_check(out_registry);
+}
+
+/**
+ * @brief reads (or maps, if @param mappable) the whole @param input, then either loads the compiled image from it or parses it as the text file (with @param num_threads)
+ * @return the error of the image or of the text, see image_load and parse_file_contents
+ */
+static Error registry_load(FILE* input, unsigned num_threads, int mappable, OUT Phone_Registry* restrict out_registry) {
+    uint64_t begin = stats_begin();
+    registry_read_source(input, mappable, out_registry);
+    stats_end(STATS_PHASE_READ, begin);
+    begin = stats_begin();
+    int loaded = 0;
+    Error error = image_load(out_registry, OUT &loaded);
+    if (error == ERROR_NONE && !loaded) {
+        error = parse_file_contents(num_threads, out_registry);
+    }
+    stats_end(STATS_PHASE_PARSE, begin);
+    return error;
+}
+
+/* =========================================
+ *                   Shard
+ * ========================================= */
+
+/**
+ * @brief one registry file (-f) of a sharded registry, loaded and matched by its own thread
+ * @note the shards share nothing, so a shard can be replaced (rewritten or compiled again with -c) without touching the others
+ */
+typedef struct _Shard_Task {
+    const Sys_Args* args;
+    const char* path;
+    Phone_Registry registry;
+    /** @brief the matches of the shard, best first if they are ranked */
+    Phone_Registry_View matches;
+    /** @brief Match_Rank(s) of the ranked matches, see match_top_drain */
+    Arena ranks;
+    Error error;
+    /** @brief nanoseconds spent in every phase, the shards run at the same time so only the slowest one is counted (see run_shards) */
+    uint64_t phases[STATS_NUM_PHASES];
+    /** @brief stats_local of the worker thread which matched the shard */
+    Stats_Counters counters;
+} Shard_Task;
+
+/** @brief the merge key of a ranked match of the @param shard: its rank without the item (the indexes of two shards cannot be compared), then the shard order */
+#define shard_merge_key(rank, shard) ((((rank) >> 32) << 8) | (Match_Rank)(shard))
+#define shard_merge_shard(key) ((unsigned)((key) & 0xff))
+static_assert(SHARDS_MAX_COUNT <= 0x100, "the shard no longer fits into the merge key");
+
+/** @brief adds the time since @param begin to the @param phase of the @param task, returns the beginning of the next one */
+inline static uint64_t _shard_lap(Shard_Task* task, Stats_Phase phase, uint64_t begin) {
+    uint64_t now = stats_begin();
+    task->phases[phase] += now - begin;
+    return now;
+}
+
+/**
+ * @brief loads and matches the shard of the @param task, same as registry_load and registry_match
+ * @note the phases are timed into the task, the global stats are only touched by the calling thread (see run_shards)
+ */
+static void _shard_run(Shard_Task* task) {
+    uint64_t begin = stats_begin();
+    FILE* input = fopen(task->path, "rb");
+    if (input == NULL) {
+        task->error = ERROR_FILE_OPEN;
+        return;
+    }
+    registry_read_source(input, 1, OUT &task->registry);
+    fclose(input);
+    begin = _shard_lap(task, STATS_PHASE_READ, begin);
+    int loaded = 0;
+    task->error = image_load(&task->registry, OUT &loaded);
+    if (task->error == ERROR_NONE && !loaded) {
+        task->error = parse_file_contents(task->args->num_threads, OUT &task->registry);
+    }
+    begin = _shard_lap(task, STATS_PHASE_PARSE, begin);
+    if (task->error != ERROR_NONE) {
+        return;
+    }
+    registry_prepare(task->args, &task->registry);
+    begin = _shard_lap(task, STATS_PHASE_BUILD, begin);
+    task->matches.ranks = &task->ranks;
+    _registry_match(task->args, &task->registry, OUT &task->matches);
+    _shard_lap(task, STATS_PHASE_MATCH, begin);
+}
+
+static thread_routine(_shard_worker, arg) {
+    Shard_Task* task = (Shard_Task*)arg;
+    _shard_run(task);
+    task->counters = stats_local;
+    return THREAD_ROUTINE_RETURN;
+}
+
+static void _shard_heap_down(Match_Rank* heap, unsigned size, unsigned parent) {
+    Match_Rank key = heap[parent];
+    for (;;) {
+        unsigned child = 2 * parent + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && heap[child + 1] < heap[child]) {
+            child++;
+        }
+        if (heap[child] >= key) {
+            break;
+        }
+        heap[parent] = heap[child];
+        parent = child;
+    }
+    heap[parent] = key;
+}
+
+/**
+ * @brief prints the matches of all the @param tasks in the global order: the shard order (then the registry order) or, if they are ranked, the rank order (then the shard order)
+ * @note the ranked matches of every shard are already sorted, so they are merged k-way through a min-heap of the next match of every shard; a limit (-l) holds for all of them together
+ */
+static void shard_print_matches(Output_Writer* restrict writer, const Sys_Args* restrict args, Shard_Task* restrict tasks, unsigned num_shards) {
+    Phone_Item_Index num_left = args->limit > 0 ? args->limit : PHONE_ITEM_INDEX_MAX_SIZE;
+    size_t num_matches = 0;
+    for (unsigned s = 0; s < num_shards; s++) {
+        num_matches += tasks[s].matches.num_indexes;
+    }
+    if (num_matches == 0) {
+        output_write(writer, NOT_FOUND_MESSAGE, sizeof(NOT_FOUND_MESSAGE) - 1);
+        return;
+    }
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0 || scan_rank_limit(args) == 0) {
+        for (unsigned s = 0; s < num_shards && num_left > 0; s++) {
+            for (Phone_Item_Index i = 0; i < tasks[s].matches.num_indexes && num_left > 0; i++, num_left--) {
+                print_match(writer, &tasks[s].registry, view_index(&tasks[s].matches, i));
+            }
+        }
+        return;
+    }
+    Match_Rank heap[SHARDS_MAX_COUNT];
+    Phone_Item_Index next[SHARDS_MAX_COUNT] = { 0 };
+    unsigned size = 0;
+    for (unsigned s = 0; s < num_shards; s++) {
+        if (tasks[s].matches.num_indexes > 0) {
+            heap[size++] = shard_merge_key(arena_as(tasks[s].ranks, Match_Rank)[0], s);
+        }
+    }
+    for (unsigned parent = size / 2; parent-- > 0;) {
+        _shard_heap_down(heap, size, parent);
+    }
+    for (; size > 0 && num_left > 0; num_left--) {
+        unsigned s = shard_merge_shard(heap[0]);
+        Shard_Task* task = &tasks[s];
+        print_match(writer, &task->registry, view_index(&task->matches, next[s]));
+        if (++next[s] < task->matches.num_indexes) {
+            heap[0] = shard_merge_key(arena_as(task->ranks, Match_Rank)[next[s]], s);
+        } else {
+            heap[0] = heap[--size];
+        }
+        _shard_heap_down(heap, size, 0);
+    }
+}
+
+/**
+ * @brief loads and matches every registry file (-f) concurrently, one thread per shard, then prints the merged matches (see shard_print_matches)
+ * @note the latency is the one of the largest shard; -j still splits the parsing and the scan of every shard
+ */
+static void run_shards(const Sys_Args* args) {
+    static Shard_Task tasks[SHARDS_MAX_COUNT];
+    Thread threads[SHARDS_MAX_COUNT];
+    int started[SHARDS_MAX_COUNT] = { 0 };
+    unsigned num_shards = args->num_shards;
+
+    for (unsigned s = 0; s < num_shards; s++) {
+        tasks[s] = (Shard_Task){ .args = args, .path = args->shard_paths[s] };
+    }
+    // the calling thread takes the first shard itself, a shard whose thread could not be created is matched here as well
+    for (unsigned s = 1; s < num_shards; s++) {
+#ifdef DEBUG
+        // the debug output of the threads would interleave
+        if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG) > 0) {
+            break;
+        }
+#endif
+        started[s] = str_success(thread_start(&threads[s], _shard_worker, &tasks[s]));
+    }
+    _shard_run(&tasks[0]);
+    for (unsigned s = 1; s < num_shards; s++) {
+        if (started[s]) {
+            thread_join(threads[s]);
+            stats_merge(&tasks[s].counters);
+        } else {
+            _shard_run(&tasks[s]);
+        }
+    }
+    for (unsigned s = 0; s < num_shards; s++) {
+        or_exit(tasks[s].error == ERROR_NONE, tasks[s].error);
+        for (int phase = 0; phase < STATS_NUM_PHASES; phase++) {
+            if (tasks[s].phases[phase] > stats.phases[phase]) {
+                stats.phases[phase] = tasks[s].phases[phase];
+            }
+        }
+    }
+    if (stats.enabled) {
+        stats.queries++;
+    }
+
+    uint64_t begin = stats_begin();
+    shard_print_matches(&output, args, tasks, num_shards);
+    or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+    stats_end(STATS_PHASE_PRINT, begin);
+
+    for (unsigned s = 0; s < num_shards; s++) {
+        arena_free(&tasks[s].ranks);
+        arena_free(&tasks[s].matches.indexes);
+        registry_free(&tasks[s].registry);
+    }
+}
+
+/* =========================================
+ *                   Edit
+ * ========================================= */
+
+/** @brief the lines of the batch (and the requests of the server) beginning with this edit the registry instead of matching it */
+#define EDIT_PREFIX '!'
+#define EDIT_SEPARATORS " \t"
+/** @brief the id of a deleted item */
+#define EDIT_ID_NONE PHONE_ITEM_INDEX_MAX_SIZE
+/** @brief "!set " + id + number + name (each one at most MAX_LINE_WIDTH) + separators + line end (CRLF at worst) + termination character */
+#define EDIT_LINE_LEN (2 * MAX_LINE_WIDTH + 32)
+/** @brief the registry should be compacted once this much of it is garbage (or missing from the suffix index), but not for less than EDIT_COMPACT_MIN_GARBAGE items */
+#define EDIT_COMPACT_RATIO 4
+#define EDIT_COMPACT_MIN_GARBAGE 1024
+
+#define registry_num_ids(registry) ((registry)->ids.size > 0 ? (registry)->ids.size / sizeof(Phone_Item_Index) : (size_t)(registry)->num_items)
+#define registry_id_index(registry, id) ((registry)->ids.size > 0 ? arena_as((registry)->ids, Phone_Item_Index)[(id)] : (Phone_Item_Index)(id))
+
+typedef enum _Edit_Kind {
+    EDIT_ADD,
+    EDIT_SET,
+    EDIT_DELETE,
+    EDIT_COMPACT,
+} Edit_Kind;
+
+/** @brief one line of the form: !add number name, !set id number name, !del id or !compact (the name is the rest of the line) */
+typedef struct _Edit_Command {
+    Edit_Kind kind;
+    Phone_Item_Index id;
+    Sized_String number;
+    Sized_String name;
+} Edit_Command;
+
+/** @brief creates the ids of the @param registry before its first edit, see Phone_Registry.ids */
+static void _edit_ids(Phone_Registry* registry) {
+    if (registry->ids.size > 0) {
+        return;
+    }
+    arena_push(&registry->ids, sizeof(Phone_Item_Index) * registry->num_items);
+    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
+        arena_as(registry->ids, Phone_Item_Index)[i] = i;
+    }
+}
+
+/**
+ * @brief copies the arenas the edits write in place if they are borrowed, before the first edit
+ * @note a compiled image (see image_load) lends them its mapping, which is read only
+ */
+static void _edit_own(Phone_Registry* registry) {
+    arena_own(&registry->items);
+    arena_own(&registry->item_texts);
+    arena_own(&registry->signatures);
+    arena_own(&registry->subsequences.tables);
+}
+
+/** @brief finds the current index of the item @param id, deleted items are not found */
+static Error _edit_find(const Phone_Registry* registry, Phone_Item_Index id, OUT Phone_Item_Index* out_index) {
+    if (id >= registry_num_ids(registry) || registry_id_index(registry, id) == EDIT_ID_NONE) {
+        return ERROR_INVALID_EDIT;
+    }
+    *out_index = registry_id_index(registry, id);
+    return ERROR_NONE;
+}
+
+/**
+ * @brief stores the fields of the item @param index at the end of the text and the t9 arenas, its previous fields (if any) become garbage
+ * @note the text may be borrowed from the input, it is copied on the first edit only
+ */
+static void _edit_write_item(Phone_Registry* registry, Phone_Item_Index index, const char* name, String_Index name_size, const char* number, String_Index number_size) {
+    size_t text = arena_push(&registry->text, (size_t)name_size + number_size);
+    memcpy(registry->text.memory + text, name, name_size);
+    memcpy(registry->text.memory + text + name_size, number, number_size);
+    // the kernels may read past the last field, the padding is moved behind the new one
+    registry->t9.size -= KERNEL_PADDING;
+    size_t t9 = arena_push(&registry->t9, (size_t)number_size + name_size + 2 + KERNEL_PADDING);
+    memset(registry->t9.memory + registry->t9.size - KERNEL_PADDING, 0, KERNEL_PADDING);
+
+    Phone_Item* item = registry_item(registry, index);
+    Phone_Item_Text* item_text = registry_item_text(registry, index);
+    item_text->name = text;
+    item->name_size = name_size;
+    item_text->number = text + name_size;
+    item->number_size = number_size;
+    item->t9 = t9;
+    t9_encode_number(item_number(registry, index), number_size, OUT item_t9_number(registry, item));
+    t9_encode_name(item_name(registry, index), name_size, OUT item_t9_name(registry, item));
+    registry_signature(registry, index) = signature_make(digit_mask(item_t9_number(registry, item), number_size, 0),
+                                                         digit_mask(item_t9_name(registry, item), name_size, 0));
+}
+
+/** @brief the suffix index is not rebuilt for the edited item @param index, it is matched linearly until registry_compact (see match_indexed) */
+static void _edit_unindex(Phone_Registry* registry, Phone_Item_Index index) {
+    Phone_Item* item = registry_item(registry, index);
+    if (!index_built(&registry->index) || (item->flags & ITEM_FLAG_UNINDEXED) != 0) {
+        return;
+    }
+    item->flags |= ITEM_FLAG_UNINDEXED;
+    size_t delta = arena_push(&registry->index.delta, sizeof(Phone_Item_Index));
+    *(Phone_Item_Index*)(registry->index.delta.memory + delta) = index;
+}
+
+/**
+ * @brief appends a new item to the @param registry, the indexes which are built already are extended by it only
+ * @return the id of the new item
+ */
+static Phone_Item_Index registry_append(Phone_Registry* registry, const Sized_String* name, const Sized_String* number) {
+    _edit_ids(registry);
+    or_exit(registry_num_ids(registry) < EDIT_ID_NONE, ERROR_FILE_TOO_LARGE);
+    Phone_Item_Index index = registry->num_items;
+    registry_push(registry);
+    _edit_write_item(registry, index, name->string, name->size, number->string, number->size);
+    if (subsequence_built(&registry->subsequences)) {
+        Phone_Item* item = registry_item(registry, index);
+        _subsequence_push_field(&registry->subsequences, item_t9_number(registry, item), item->number_size);
+        _subsequence_push_field(&registry->subsequences, item_t9_name(registry, item), item->name_size);
+    }
+    _edit_unindex(registry, index);
+    size_t id = arena_push(&registry->ids, sizeof(Phone_Item_Index));
+    *(Phone_Item_Index*)(registry->ids.memory + id) = index;
+    return (Phone_Item_Index)(id / sizeof(Phone_Item_Index));
+}
+
+/** @brief replaces the fields of the item @param id in place, it keeps its id and its position in the registry */
+static Error registry_update(Phone_Registry* registry, Phone_Item_Index id, const Sized_String* name, const Sized_String* number) {
+    Phone_Item_Index index;
+    Error error = _edit_find(registry, id, OUT &index);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+    _edit_ids(registry);
+    _edit_write_item(registry, index, name->string, name->size, number->string, number->size);
+    if (subsequence_built(&registry->subsequences)) {
+        Phone_Item* item = registry_item(registry, index);
+        _subsequence_fill_table(&registry->subsequences, 2 * (size_t)index, item_t9_number(registry, item), item->number_size);
+        _subsequence_fill_table(&registry->subsequences, 2 * (size_t)index + 1, item_t9_name(registry, item), item->name_size);
+    }
+    _edit_unindex(registry, index);
+    registry->num_garbage++;
+    return ERROR_NONE;
+}
+
+/** @brief tombstones the item @param id, it is skipped by every search until registry_compact drops it */
+static Error registry_delete(Phone_Registry* registry, Phone_Item_Index id) {
+    Phone_Item_Index index;
+    Error error = _edit_find(registry, id, OUT &index);
+    if (error != ERROR_NONE) {
+        return error;
+    }
+    _edit_ids(registry);
+    registry_item(registry, index)->flags |= ITEM_FLAG_TOMBSTONE;
+    arena_as(registry->ids, Phone_Item_Index)[id] = EDIT_ID_NONE;
+    registry->num_garbage++;
+    return ERROR_NONE;
+}
+
+/**
+ * @brief copies the live items of the @param registry into the empty @param out_compacted, the indexes built in the registry are built again for them
+ * @note the registry is only read, the items keep their ids and their order (the ids ascend with the indexes)
+ */
+static void registry_compact(const Phone_Registry* registry, OUT Phone_Registry* out_compacted) {
+    size_t padding = arena_push(&out_compacted->t9, KERNEL_PADDING);
+    memset(out_compacted->t9.memory + padding, 0, KERNEL_PADDING);
+    size_t num_ids = registry_num_ids(registry);
+    arena_push(&out_compacted->ids, sizeof(Phone_Item_Index) * num_ids);
+    for (size_t id = 0; id < num_ids; id++) {
+        Phone_Item_Index index = registry_id_index(registry, id);
+        if (index == EDIT_ID_NONE) {
+            arena_as(out_compacted->ids, Phone_Item_Index)[id] = EDIT_ID_NONE;
+            continue;
+        }
+        const Phone_Item* item = registry_item(registry, index);
+        arena_as(out_compacted->ids, Phone_Item_Index)[id] = out_compacted->num_items;
+        registry_push(out_compacted);
+        _edit_write_item(out_compacted, out_compacted->num_items - 1, item_name(registry, index), item->name_size, item_number(registry, index), item->number_size);
+    }
+    if (subsequence_built(&registry->subsequences)) {
+        subsequence_build(out_compacted);
+    }
+    if (index_built(&registry->index)) {
+        index_build(out_compacted);
+    }
+}
+
+/** @brief whether the garbage of the @param registry (and the items its suffix index misses) is worth a registry_compact */
+inline static int registry_needs_compaction(const Phone_Registry* registry) {
+    size_t garbage = registry->num_garbage + registry->index.delta.size / sizeof(Phone_Item_Index);
+    return garbage >= EDIT_COMPACT_MIN_GARBAGE && garbage >= registry->num_items / EDIT_COMPACT_RATIO;
+}
+
+/** @brief cuts the next token off the @param cursor (and moves the cursor behind it) */
+static char* _edit_token(char** cursor) {
+    char* token = *cursor + strspn(*cursor, EDIT_SEPARATORS);
+    char* token_end = token + strcspn(token, EDIT_SEPARATORS);
+    *cursor = *token_end != '\0' ? token_end + 1 : token_end;
+    *token_end = '\0';
+    return token;
+}
+
+static Error _edit_set_field(Sized_String* field, const char* value) {
+    size_t size = strlen(value);
+    if (size > MAX_LINE_WIDTH) {
+        return ERROR_LINE_TOO_LARGE;
+    }
+    field->size = (String_Index)size;
+    memcpy(field->string, value, size);
+    return ERROR_NONE;
+}
+
+/** @brief whether the @param line of the batch (or of the server) is an edit instead of a query */
+inline static int edit_is_command(const char* line) {
+    return line[strspn(line, EDIT_SEPARATORS)] == EDIT_PREFIX;
+}
+
+/**
+ * @brief parses the edit @param line into the @param out_command (the line is split in place)
+ * @note the number has to be made of the number characters only, the name is the rest of the line behind it
+ */
+static Error edit_parse_command(char* line, OUT Edit_Command* out_command) {
+    memset(out_command, 0, sizeof(Edit_Command));
+    line[strcspn(line, "\r\n")] = '\0';
+    char* cursor = line + strspn(line, EDIT_SEPARATORS) + 1;
+    const char* verb = _edit_token(&cursor);
+    if (str_success(strcmp(verb, "add"))) {
+        out_command->kind = EDIT_ADD;
+    } else if (str_success(strcmp(verb, "set"))) {
+        out_command->kind = EDIT_SET;
+    } else if (str_success(strcmp(verb, "del"))) {
+        out_command->kind = EDIT_DELETE;
+    } else if (str_success(strcmp(verb, "compact"))) {
+        out_command->kind = EDIT_COMPACT;
+    } else {
+        return ERROR_INVALID_EDIT;
+    }
+    if (out_command->kind == EDIT_SET || out_command->kind == EDIT_DELETE) {
+        const char* id = _edit_token(&cursor);
+        if (id[0] == '\0' || strspn(id, "0123456789") != strlen(id) || strlen(id) > 10) {
+            return ERROR_INVALID_EDIT;
+        }
+        unsigned long long value = strtoull(id, NULL, 10);
+        if (value >= EDIT_ID_NONE) {
+            return ERROR_INVALID_EDIT;
+        }
+        out_command->id = (Phone_Item_Index)value;
+    }
+    if (out_command->kind == EDIT_ADD || out_command->kind == EDIT_SET) {
+        const char* number = _edit_token(&cursor);
+        if (number[0] == '\0' || str_fail(string_is_number((String_View)number))) {
+            return ERROR_INVALID_NUMBER;
+        }
+        Error error = _edit_set_field(&out_command->number, number);
+        return error != ERROR_NONE ? error : _edit_set_field(&out_command->name, cursor);
+    }
+    // nothing may follow the id (or the compaction)
+    return cursor[strspn(cursor, EDIT_SEPARATORS)] == '\0' ? ERROR_NONE : ERROR_INVALID_EDIT;
+}
+
+/**
+ * @brief applies the @param command to the @param registry, the compaction is done in place
+ * @note the @param out_result is the id of the edited item, or the number of the items kept by the compaction
+ */
+static Error registry_edit(Phone_Registry* registry, const Edit_Command* command, OUT Phone_Item_Index* out_result) {
+    if (command->kind != EDIT_COMPACT) {
+        _edit_own(registry);
+    }
+    switch (command->kind) {
+    case EDIT_ADD:
+        *out_result = registry_append(registry, &command->name, &command->number);
+        return ERROR_NONE;
+    case EDIT_SET:
+        *out_result = command->id;
+        return registry_update(registry, command->id, &command->name, &command->number);
+    case EDIT_DELETE:
+        *out_result = command->id;
+        return registry_delete(registry, command->id);
+    case EDIT_COMPACT: {
+        Phone_Registry compacted = { 0 };
+        registry_compact(registry, OUT &compacted);
+        registry_free(registry);
+        *registry = compacted;
+        *out_result = registry->num_items;
+        return ERROR_NONE;
+    }
+    }
+    return ERROR_INVALID_EDIT;
+}
+
+/** @brief answers an edit with the line "OK result" followed by an empty line (the same as a result block) */
+static void edit_print_result(Output_Writer* writer, Phone_Item_Index result) {
+    char line[32];
+    int size = snprintf(line, sizeof(line), "OK %lu\n\n", (unsigned long)result);
+    output_write(writer, line, (size_t)size);
+}
+
+/* =========================================
+ *                   Batch
+ * ========================================= */
+
+/** @brief long enough for an edit, the longest query is "-s " + keyboard input + line end (CRLF at worst) + termination character */
+#define BATCH_LINE_LEN EDIT_LINE_LEN
+
+#define BATCH_SEPARATORS " \t\r\n"
+
+/**
+ * @brief parses one line of the batch into the keyboard input of the @param query
+ * @return the error of the line (the line is split in place, no strtok, the server parses the queries of many connections at once)
+ * @note the line has the same form as the arguments: [-s] [#number], an empty line lists the whole registry
+ */
+static Error batch_parse_query(char* line, Sys_Args* query) {
+    query->optionals &= ~(OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH | OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER);
+    memset(&query->keyboard_input, 0, sizeof(Sized_String));
+    for (char* token = line + strspn(line, BATCH_SEPARATORS); *token != '\0'; token += strspn(token, BATCH_SEPARATORS)) {
+        char* token_end = token + strcspn(token, BATCH_SEPARATORS);
+        int last = *token_end == '\0';
+        *token_end = '\0';
+        if (str_success(strcmp(token, "-s"))) {
+            query->optionals |= OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH;
+        } else {
+            Error error = _sys_args_try_number(query, token);
+            if (error != ERROR_NONE) {
+                return error;
+            }
+        }
+        token = last ? token_end : token_end + 1;
+    }
+    return ERROR_NONE;
+}
+
+/** @brief at most this many consecutive queries of the batch are matched together, see Batch_Group */
+#define BATCH_GROUP_SIZE 4096
+/** @brief one pass of the automaton costs about as much as this many passes of the match kernels (per thread of the scan) */
+#define BATCH_GROUP_MIN_QUERIES 8
+
+/** @brief consecutive queries of the batch (up to the next edit), the plain ones of them are matched in one pass of the automaton */
+typedef struct _Batch_Group {
+    /** @brief Sys_Args of every query in the order of the lines */
+    Arena queries;
+    size_t size;
+    Query_Automaton automaton;
+} Batch_Group;
+
+/** @brief whether the @param query is matched by the automaton, the other ones (and the ones to be debugged) are matched alone by registry_match */
+inline static int _batch_groupable(const Sys_Args* query) {
+    Optional_Sys_Args_Footprint alone = OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH | OPTIONAL_SYS_ARG_FOOTPRINT_INDEX | OPTIONAL_SYS_ARG_FOOTPRINT_DEBUG;
+    return (query->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) > 0 && (query->optionals & alone) == 0 && query->max_errors == 0;
+}
+
+/** @brief matches and prints all the queries of the @param group in the order of their lines, the group is emptied */
+static void _batch_flush(const Sys_Args* restrict args, Batch_Group* restrict group, Phone_Registry* restrict registry, Phone_Registry_View* restrict matches) {
+    const Sys_Args* queries = arena_as(group->queries, Sys_Args);
+    uint32_t num_grouped = 0;
+    for (size_t i = 0; i < group->size; i++) {
+        num_grouped += (uint32_t)_batch_groupable(&queries[i]);
+    }
+    // a few queries are matched alone, the kernels (and the threads) of match are faster than the automaton
+    int grouped = num_grouped >= BATCH_GROUP_MIN_QUERIES * (args->num_threads > 0 ? args->num_threads : 1);
+    if (grouped) {
+        uint64_t begin = stats_begin();
+        for (size_t i = 0; i < group->size; i++) {
+            if (_batch_groupable(&queries[i])) {
+                automaton_add(&group->automaton, &queries[i].keyboard_input, queries[i].limit);
+            }
+        }
+        automaton_match(&group->automaton, registry);
+        stats_end(STATS_PHASE_MATCH, begin);
+        if (stats.enabled) {
+            stats.queries += num_grouped;
+        }
+    }
+    uint32_t q = 0;
+    for (size_t i = 0; i < group->size; i++) {
+        Phone_Registry_View* view = matches;
+        if (grouped && _batch_groupable(&queries[i])) {
+            view = &automaton_query(&group->automaton, q++)->matches;
+        } else {
+            view_clear(matches);
+            registry_match(&queries[i], registry, matches);
+        }
+        uint64_t begin = stats_begin();
+        print_matches(&output, registry, view);
+        output_write(&output, "\n", 1);
+        output_end_block(&output);
+        stats_end(STATS_PHASE_PRINT, begin);
+    }
+    automaton_clear(&group->automaton);
+    group->queries.size = 0;
+    group->size = 0;
+}
+
+/**
+ * @brief matches every line of the batch against the same @param registry, the lines beginning with EDIT_PREFIX edit it in between
+ * @note every result block (see print_matches) is terminated by an empty line
+ * @note the consecutive plain queries are matched together (see _batch_flush) unless the batch is typed in a terminal, where every line is answered right away
+ */
+static void run_batch(const Sys_Args* args, Phone_Registry* registry) {
+    FILE* batch = str_success(strcmp(args->batch_path, "-")) ? stdin : fopen(args->batch_path, "r");
+    or_exit(batch != NULL, ERROR_FILE_OPEN);
+
+    static char line[BATCH_LINE_LEN];
+    Sys_Args query = *args;
+    Phone_Registry_View matches = { 0 };
+    static Batch_Group group = { 0 };
+    size_t group_size = is_file_terminal(batch) ? 1 : BATCH_GROUP_SIZE;
+    while (fgets(line, sizeof(line), batch) != NULL) {
+        // the queries before the edit see the registry as it was, the ones before an invalid line are still answered
+        Error error = strchr(line, '\n') != NULL || feof(batch) ? ERROR_NONE : ERORR_INVALID_NUMBER_ARG_LENGTH;
+        if (error == ERROR_NONE && !edit_is_command(line)) {
+            error = batch_parse_query(line, &query);
+        }
+        if (error != ERROR_NONE || edit_is_command(line)) {
+            _batch_flush(args, &group, registry, &matches);
+        }
+        if (error != ERROR_NONE) {
+            do_exit(error);
+        }
+        if (edit_is_command(line)) {
+            uint64_t begin = stats_begin();
+            Edit_Command command;
+            Phone_Item_Index result = 0;
+            error = edit_parse_command(line, OUT &command);
+            if (error != ERROR_NONE || (error = registry_edit(registry, &command, OUT &result)) != ERROR_NONE) {
+                do_exit(error);
+            }
+            stats_end(STATS_PHASE_BUILD, begin);
+            edit_print_result(&output, result);
+            output_end_block(&output);
+            continue;
+        }
+        size_t offset = arena_push(&group.queries, sizeof(Sys_Args));
+        memcpy(group.queries.memory + offset, &query, sizeof(Sys_Args));
+        if (++group.size == group_size) {
+            _batch_flush(args, &group, registry, &matches);
+        }
+    }
+    _batch_flush(args, &group, registry, &matches);
+
+    automaton_free(&group.automaton);
+    arena_free(&group.queries);
+    arena_free(&matches.indexes);
+    if (batch != stdin) {
+        fclose(batch);
+    }
+}
+
+/* =========================================
+ *                  Session
+ * ========================================= */
+
+/** @brief erases the last typed key (-t) */
+#define SESSION_BACKSPACE '<'
+
+/**
+ * @brief an item which still matches the keys typed so far
+ * @note its offsets are relative to the t9 record of the item (see Phone_Item.t9), the ones up to number_size point into the t9_number, the others into the t9_name
+ */
+typedef struct _Session_Candidate {
+    Phone_Item_Index item;
+    /** @brief the offsets of the candidate are at first .. first + count inside of Session_Level.offsets */
+    Text_Offset first;
+    String_Index count;
+} Session_Candidate;
+
+/** @brief state of the search after some number of keys */
+typedef struct _Session_Level {
+    /** @brief the matching items in the registry order (Session_Candidate) */
+    Arena candidates;
+    /**
+     * @brief where the typed keys occur in the fields of the candidates (String_Index)
+     * @note substring search: beginnings of the occurrences, subsequence search (-s): per field the position behind the last matched key
+     */
+    Arena offsets;
+} Session_Level;
+
+/**
+ * @brief incremental search refining the matches of the previous keys with every new one
+ * @note the levels are kept when a key is erased, so typing it again only has to compute the last level
+ */
+typedef struct _Session {
+    int subsequence;
+    /** @brief the keys typed so far, the state after the first d keys is in levels[d] (the level 0 is the whole registry and it is never stored) */
+    Sized_String typed;
+    Session_Level levels[MAX_STR_LEN];
+} Session;
+
+#define session_candidate(level, i) (&arena_as((level)->candidates, Session_Candidate)[(i)])
+#define session_num_candidates(level) ((level)->candidates.size / sizeof(Session_Candidate))
+
+/**
+ * @brief moves the @param count offsets of the item @param index by the typed @param key and keeps it as a candidate of the @param next level if any of them is left
+ * @note a typed '+' is folded for the t9_number only, it never matches a t9_name
+ */
+static void _session_refine(const Session* restrict session, const Phone_Registry* restrict registry, Phone_Item_Index index, const String_Index* restrict offsets, String_Index count, char key, OUT Session_Level* restrict next) {
+    const Phone_Item* item = registry_item(registry, index);
+    const char* t9 = item_t9_number(registry, item);
+    String_Index depth = (String_Index)(session->typed.size - 1);
+    String_Index name_end = (String_Index)(item->number_size + 1 + item->name_size);
+    String_Index kept[2 * MAX_STR_LEN];
+    String_Index num_kept = 0;
+    for (String_Index k = 0; k < count; k++) {
+        String_Index at = offsets[k];
+        int in_number = at <= item->number_size;
+        char expected = in_number && key == '+' ? '0' : key;
+        if (session->subsequence) {
+            String_Index end = in_number ? item->number_size : name_end;
+            const char* found = memchr(t9 + at, expected, (size_t)(end - at));
+            if (found != NULL) {
+                kept[num_kept++] = (String_Index)(found - t9 + 1);
+            }
+        } else if (t9[at + depth] == expected) {
+            // the fields are terminated, an occurrence can never run into the next one
+            kept[num_kept++] = at;
+        }
+    }
+    stats_local.entries++;
+    stats_local.candidates += count;
+    if (num_kept == 0) {
+        return;
+    }
+    if (kept[0] <= item->number_size) {
+        stats_local.hits_number++;
+    } else {
+        stats_local.hits_name++;
+    }
+    size_t candidate_offset = arena_push(&next->candidates, sizeof(Session_Candidate));
+    Session_Candidate* candidate = (Session_Candidate*)(next->candidates.memory + candidate_offset);
+    candidate->item = index;
+    candidate->first = arena_push(&next->offsets, num_kept);
+    candidate->count = num_kept;
+    memcpy(next->offsets.memory + candidate->first, kept, num_kept);
+}
+
+/**
+ * @brief appends the @param key to the typed keys, only the candidates of the previous level are checked again
+ * @note the first key has to scan the whole registry, it starts from every position of the key (substring) or from the beginning of both fields (subsequence)
+ */
+static void session_type(Session* restrict session, const Phone_Registry* restrict registry, char key) {
+    or_exit(session->typed.size + 1 < MAX_STR_LEN, ERORR_INVALID_NUMBER_ARG_LENGTH);
+    String_Index depth = session->typed.size;
+    session->typed.string[session->typed.size++] = key;
+    Session_Level* next = &session->levels[depth + 1];
+    next->candidates.size = 0;
+    next->offsets.size = 0;
+    if (depth > 0) {
+        const Session_Level* level = &session->levels[depth];
+        const String_Index* offsets = arena_as(level->offsets, String_Index);
+        for (size_t c = 0; c < session_num_candidates(level); c++) {
+            const Session_Candidate* candidate = session_candidate(level, c);
+            _session_refine(session, registry, candidate->item, offsets + candidate->first, candidate->count, key, OUT next);
+        }
+        return;
+    }
+    String_Index starts[2 * MAX_STR_LEN];
+    for (Phone_Item_Index i = 0; i < registry->num_items; i++) {
+        const Phone_Item* item = registry_item(registry, i);
+        if ((item->flags & ITEM_FLAG_TOMBSTONE) != 0) {
+            continue;
+        }
+        String_Index num_starts = 0;
+        if (session->subsequence) {
+            starts[num_starts++] = 0;
+            starts[num_starts++] = (String_Index)(item->number_size + 1);
+        } else {
+            // only the positions of the key itself can start an occurrence
+            const char* t9 = item_t9_number(registry, item);
+            const char* end = t9 + item->number_size + 1 + item->name_size;
+            for (const char* at = memchr(t9, key == '+' ? '0' : key, item->number_size); at != NULL; at = memchr(at + 1, key == '+' ? '0' : key, (size_t)(t9 + item->number_size - at - 1))) {
+                starts[num_starts++] = (String_Index)(at - t9);
+            }
+            for (const char* at = memchr(t9 + item->number_size + 1, key, item->name_size); at != NULL; at = memchr(at + 1, key, (size_t)(end - at - 1))) {
+                starts[num_starts++] = (String_Index)(at - t9);
+            }
+        }
+        _session_refine(session, registry, i, starts, num_starts, key, OUT next);
+    }
+}
+
+/** @brief erases the last typed key, the previous level is still there */
+inline static void session_erase(Session* session) {
+    if (session->typed.size > 0) {
+        session->typed.size--;
+    }
+}
+
+/** @brief prints the candidates of the current level, the whole registry if nothing is typed (see registry_match) */
+static void session_print(Output_Writer* restrict writer, const Session* restrict session, Phone_Registry* restrict registry) {
+    if (session->typed.size == 0) {
+        Phone_Registry_View all = { 0 };
+        registry_match(&(Sys_Args){ 0 }, registry, &all);
+        print_matches(writer, registry, &all);
+        arena_free(&all.indexes);
+        return;
+    }
+    const Session_Level* level = &session->levels[session->typed.size];
+    size_t num_candidates = session_num_candidates(level);
+    if (num_candidates == 0) {
+        output_write(writer, NOT_FOUND_MESSAGE, sizeof(NOT_FOUND_MESSAGE) - 1);
+        return;
+    }
+    for (size_t c = 0; c < num_candidates; c++) {
+        print_match(writer, registry, session_candidate(level, c)->item);
+    }
+}
+
+static void session_free(Session* session) {
+    for (String_Index d = 0; d < MAX_STR_LEN; d++) {
+        arena_free(&session->levels[d].offsets);
+        arena_free(&session->levels[d].candidates);
+    }
+    session->typed.size = 0;
+}
+
+/**
+ * @brief reads the keystrokes line by line, every line may type any number of keys (and erase them with SESSION_BACKSPACE)
+ * @note the matches of the keys typed so far are printed after every line, the result block is terminated by an empty line (same as the batch)
+ */
+static void run_session(const Sys_Args* args, Phone_Registry* registry) {
+    FILE* keystrokes = str_success(strcmp(args->session_path, "-")) ? stdin : fopen(args->session_path, "r");
+    or_exit(keystrokes != NULL, ERROR_FILE_OPEN);
+
+    static Session session = { 0 };
+    session.subsequence = (args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) > 0;
+    static char line[BATCH_LINE_LEN];
+    while (fgets(line, sizeof(line), keystrokes) != NULL) {
+        or_exit(strchr(line, '\n') != NULL || feof(keystrokes), ERORR_INVALID_NUMBER_ARG_LENGTH);
+        uint64_t begin = stats_begin();
+        for (const char* key = line; *key != '\0'; key++) {
+            if (*key == SESSION_BACKSPACE) {
+                session_erase(&session);
+            } else if (str_success(char_is_number(*key))) {
+                session_type(&session, registry, *key);
+            } else {
+                or_exit(strchr(" \t\r\n", *key) != NULL, ERORR_INVALID_NUMBER_ARG);
+            }
+        }
+        stats_end(STATS_PHASE_MATCH, begin);
+        stats.queries++;
+        begin = stats_begin();
+        session_print(&output, &session, registry);
+        output_write(&output, "\n", 1);
+        output_end_block(&output);
+        stats_end(STATS_PHASE_PRINT, begin);
+    }
+
+    session_free(&session);
+    if (keystrokes != stdin) {
+        fclose(keystrokes);
+    }
+}
+
+/* =========================================
+ *                  Stream
+ * ========================================= */
+
+/** @brief the registry is read (-p) in blocks of at most this size, only the last block and the record left unfinished by it are kept */
+#define STREAM_BUFFER_SIZE (64 * 1024)
+static_assert(STREAM_BUFFER_SIZE > 2 * (MAX_LINE_WIDTH + 2), "A record of the registry does not fit into the STREAM_BUFFER_SIZE");
+/** @brief neither of the fields of the record matched, see _stream_match */
+#define STREAM_NO_MATCH -1
+
+/** @brief the registry being matched while it is read, its memory does not depend on the size of the registry */
+typedef struct _Stream {
+    FILE* input;
+    int eof;
+    size_t size;
+    char buffer[STREAM_BUFFER_SIZE];
+    /** @brief the fields of the current record, encoded the same way as the t9 arena of the registry (padded for the kernels) */
+    char t9_number[MAX_STR_LEN + KERNEL_PADDING];
+    char t9_name[MAX_STR_LEN + KERNEL_PADDING];
+} Stream;
+
+/** @brief appends whatever the input of the @param stream has ready (a pipe does not wait for the whole block), sets eof at its end */
+static void _stream_fill(Stream* stream) {
+    char* at = stream->buffer + stream->size;
+    size_t capacity = STREAM_BUFFER_SIZE - stream->size;
+#if defined(_WIN32)
+    int num_read = _read(_fileno(stream->input), at, (unsigned)capacity);
+#elif defined(__unix__)
+    ssize_t num_read;
+    do {
+        num_read = read(fileno(stream->input), at, capacity);
+    } while (num_read < 0 && errno == EINTR);
+#else
+    size_t num_read = fread(at, 1, capacity, stream->input);
+#endif
+    if (num_read <= 0) {
+        stream->eof = 1;
+        return;
+    }
+    stream->size += (size_t)num_read;
+}
+
+/**
+ * @brief same as _parse_next_line, the line has to be read completely though (only the last line of the input may be unterminated)
+ * @return 0 on success and 1 if the rest of the line is yet to be read (or there are no more lines)
+ */
+static int _stream_next_line(const Stream* stream, const char** cursor, OUT Parse_Line* out_line) {
+    const char* end = stream->buffer + stream->size;
+    if (!stream->eof && memchr(*cursor, '\n', (size_t)(end - *cursor)) == NULL) {
+        // the line cannot be kept waiting for its end indefinitely, it is too wide already (one more byte may still be the trimmed '\r')
+        or_exit(end - *cursor <= MAX_LINE_WIDTH + 1, ERROR_LINE_TOO_LARGE);
+        return STR_FAIL;
+    }
+    return _parse_next_line(cursor, end, out_line);
+}
+
+/** @brief whether the keys of the @param t9_phone occur in this order (not necessarily next to each other) in the @param field */
+static int _stream_is_subsequence(const Sized_String* t9_phone, const char* field, String_Index size) {
+    String_Index k = 0;
+    for (String_Index i = 0; i < size && k < t9_phone->size; i++) {
+        k += field[i] == t9_phone->string[k];
+    }
+    return k == t9_phone->size;
+}
+
+/**
+ * @brief matches the record of the @param name and the @param number the same way match (or match_ex with -s) matches an item
+ * @return the field which matched (MATCH_FIELD_*), STREAM_NO_MATCH if none of them
+ */
+static int _stream_match(Stream* stream, const Sys_Args* args, const Sized_String* t9_phone, const Parse_Line* name, const Parse_Line* number) {
+    const Sized_String* phone = &args->keyboard_input;
+    String_Index number_size = (String_Index)number->size;
+    String_Index name_size = (String_Index)name->size;
+    stats_local.entries++;
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_NUMBER) == 0) {
+        // nothing typed lists every record
+        return MATCH_FIELD_NUMBER;
+    }
+    t9_encode_number(number->begin, number_size, OUT stream->t9_number);
+    t9_encode_name(name->begin, name_size, OUT stream->t9_name);
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_SEARCH) != 0) {
+        if (_stream_is_subsequence(t9_phone, stream->t9_number, number_size)) {
+            return MATCH_FIELD_NUMBER;
+        }
+        // '+' can be typed only in numbers
+        int numbers_only = memchr(phone->string, '+', phone->size) != NULL;
+        return !numbers_only && _stream_is_subsequence(t9_phone, stream->t9_name, name_size) ? MATCH_FIELD_NAME : STREAM_NO_MATCH;
+    }
+    if (string_find(t9_phone, stream->t9_number, number_size) != STRING_NOT_FOUND) {
+        return MATCH_FIELD_NUMBER;
+    }
+    return string_find(phone, stream->t9_name, name_size) != STRING_NOT_FOUND ? MATCH_FIELD_NAME : STREAM_NO_MATCH;
+}
+
+/**
+ * @brief matches the registry of the @param input record by record while it is being read (-p), the matches are written after every block read
+ * @note the registry is validated the same way as by parse_file_contents, the matches of the records before an invalid one are printed already
+ */
+static void run_stream(const Sys_Args* args, FILE* input) {
+    static Stream stream = { 0 };
+    stream.input = input;
+    Sized_String t9_phone = t9_fold_phone(&args->keyboard_input);
+    int found = 0;
+    while (!stream.eof) {
+        uint64_t begin = stats_begin();
+        _stream_fill(&stream);
+        const char* cursor = stream.buffer;
+        Parse_Line name, number;
+        for (;;) {
+            const char* record = cursor;
+            if (str_fail(_stream_next_line(&stream, &cursor, OUT &name))) {
+                break;
+            }
+            or_exit(name.size <= MAX_LINE_WIDTH, ERROR_LINE_TOO_LARGE);
+            if (str_fail(_stream_next_line(&stream, &cursor, OUT &number))) {
+                // only a trailing empty line is tolerated
+                or_exit(!stream.eof || name.size == 0, ERROR_FILE_SIZE_MISMATCH);
+                cursor = record;
+                break;
+            }
+            or_exit(number.size <= MAX_LINE_WIDTH, ERROR_LINE_TOO_LARGE);
+            or_exit(str_success(_parse_is_number(&number)), ERROR_INVALID_NUMBER);
+            int field = _stream_match(&stream, args, &t9_phone, &name, &number);
+            if (field != STREAM_NO_MATCH) {
+                stats_local.hits_number += field == MATCH_FIELD_NUMBER;
+                stats_local.hits_name += field == MATCH_FIELD_NAME;
+                print_fields(&output, name.begin, (String_Index)name.size, number.begin, (String_Index)number.size);
+                found = 1;
+            }
+        }
+        // the unfinished record is kept for the next block
+        stream.size -= (size_t)(cursor - stream.buffer);
+        memmove(stream.buffer, cursor, stream.size);
+        stats_end(STATS_PHASE_MATCH, begin);
+        begin = stats_begin();
+        or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+        stats_end(STATS_PHASE_PRINT, begin);
+    }
+    if (!found) {
+        output_write(&output, NOT_FOUND_MESSAGE, sizeof(NOT_FOUND_MESSAGE) - 1);
+    }
+}
+
+/* =========================================
+ *                   Server
+ * ========================================= */
+
+#if defined(__unix__)
+
+#define SERVER_DEFAULT_WORKERS 4
+#define SERVER_BACKLOG 64
+/** @brief the requests of a connection are read in chunks of this size, a line has to fit in it */
+#define SERVER_READ_SIZE 4096
+#define SERVER_INVALID_QUERY "Invalid query\n"
+
+/**
+ * @brief serves one registry to many connections, each worker thread takes one connection at a time
+ * @note the queries only read the registry, the edits change it under the write lock and a reload (or a compaction) builds the new one aside and swaps it under the write lock
+ */
+typedef struct _Server {
+    const Sys_Args* args;
+    int listener;
+    pthread_rwlock_t lock;
+    /** @brief taken before the lock, a writer waiting in it holds off the new readers (the rwlock itself may prefer the readers forever) */
+    pthread_mutex_t turnstile;
+    Phone_Registry* registry;
+    /** @brief held by whoever changes the registry (edit, reload, compaction), the registry can be read without the read lock while it is held */
+    pthread_mutex_t edits;
+    /** @brief wakes up the compactor, see _server_compactor */
+    pthread_cond_t compaction;
+    int compaction_requested;
+    int stopping;
+    /** @brief the connection every worker serves (-1 if none), shut down when the server stops so that no worker stays blocked reading or writing it */
+    int connections[THREADS_MAX_COUNT];
+    /** @brief guards the connections and closing */
+    pthread_mutex_t connections_lock;
+    int closing;
+} Server;
+
+/** @brief the argument of a worker thread, its slot in the connections of the server */
+typedef struct _Server_Worker {
+    Server* server;
+    unsigned slot;
+} Server_Worker;
+
+/**
+ * @brief registers the @param connection of the worker @param slot
+ * @return 0 on success and 1 if the server is closing already, the connection is not to be served then
+ */
+static int _server_connect(Server* server, unsigned slot, int connection) {
+    pthread_mutex_lock(&server->connections_lock);
+    int closing = server->closing;
+    if (!closing) {
+        server->connections[slot] = connection;
+    }
+    pthread_mutex_unlock(&server->connections_lock);
+    return closing ? STR_FAIL : STR_SUCCESS;
+}
+
+/** @brief unregisters the connection of the worker @param slot, before it is closed (its descriptor may be reused then) */
+static void _server_disconnect(Server* server, unsigned slot) {
+    pthread_mutex_lock(&server->connections_lock);
+    server->connections[slot] = -1;
+    pthread_mutex_unlock(&server->connections_lock);
+}
+
+/** @brief shuts down every connection being served, the workers see them closed and go back to the (shut down) listener */
+static void _server_close_connections(Server* server, unsigned num_workers) {
+    pthread_mutex_lock(&server->connections_lock);
+    server->closing = 1;
+    for (unsigned w = 0; w < num_workers; w++) {
+        if (server->connections[w] >= 0) {
+            shutdown(server->connections[w], SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&server->connections_lock);
+}
+
+static void _server_read_lock(Server* server) {
+    pthread_mutex_lock(&server->turnstile);
+    pthread_rwlock_rdlock(&server->lock);
+    pthread_mutex_unlock(&server->turnstile);
+}
+
+static void _server_write_lock(Server* server) {
+    pthread_mutex_lock(&server->turnstile);
+    pthread_rwlock_wrlock(&server->lock);
+    pthread_mutex_unlock(&server->turnstile);
+}
+
+/**
+ * @brief builds everything the queries may need, under the write lock or before the registry is swapped in
+ * @note the workers match through _registry_match, the lazy builds of registry_prepare would race between them: an index left without any suffix (no field has a key) counts as not built and would be built again by every query
+ */
+static void _server_prepare(const Sys_Args* args, Phone_Registry* registry) {
+    if (!subsequence_built(&registry->subsequences)) {
+        subsequence_build(registry);
+    }
+    if ((args->optionals & OPTIONAL_SYS_ARG_FOOTPRINT_INDEX) > 0 && !index_built(&registry->index)) {
+        index_build(registry);
+    }
+}
+
+static void _server_unload(Phone_Registry* registry) {
+    registry_free(registry);
+    free(registry);
+}
+
+/**
+ * @brief loads the registry of the server from its file, see _server_prepare
+ * @return the error of the file instead of exiting, a reload of a broken file must not stop the server
+ */
+static Error _server_load(const Sys_Args* args, OUT Phone_Registry** out_registry) {
+    FILE* input = fopen(args->registry_path, "rb");
+    if (input == NULL) {
+        return ERROR_FILE_OPEN;
+    }
+    Phone_Registry* registry = calloc(1, sizeof(Phone_Registry));
+    or_exit(registry != NULL, ERROR_FILE_TOO_LARGE);
+    // the file is read, not mapped, the registry being served must not change (or vanish) when the file is replaced in place
+    Error error = registry_load(input, args->num_threads, 0, OUT registry);
+    fclose(input);
+    if (error != ERROR_NONE) {
+        _server_unload(registry);
+        return error;
+    }
+    _server_prepare(args, registry);
+    *out_registry = registry;
+    return ERROR_NONE;
+}
+
+/** @brief swaps in the @param registry, the queries in flight finish with the old one */
+static void _server_swap(Server* server, Phone_Registry* registry) {
+    _server_write_lock(server);
+    Phone_Registry* old = server->registry;
+    server->registry = registry;
+    pthread_rwlock_unlock(&server->lock);
+    _server_unload(old);
+}
+
+/** @brief swaps in the registry loaded from the file again, the edits made since the last load are dropped, the old registry keeps being served if the file cannot be loaded */
+static void server_reload(Server* server) {
+    Phone_Registry* registry = NULL;
+    Error error = _server_load(server->args, OUT &registry);
+    if (error != ERROR_NONE) {
+        print_error("[Server]: could not reload %s, still serving the previous registry\n", server->args->registry_path);
+        on_exit_error(error);
+        return;
+    }
+    // the registry may be compacted away (and freed) as soon as the edits are unlocked
+    Phone_Item_Index num_items = registry->num_items;
+    pthread_mutex_lock(&server->edits);
+    _server_swap(server, registry);
+    server->compaction_requested = 0;
+    pthread_mutex_unlock(&server->edits);
+    print_error("[Server]: reloaded %s (%lu items)\n", server->args->registry_path, (unsigned long)num_items);
+}
+
+/**
+ * @brief compacts the registry aside and swaps it in, the edits mutex has to be held
+ * @return the number of the items kept
+ * @note the workers keep answering from the old registry meanwhile, only the edits wait for the compaction
+ */
+static Phone_Item_Index _server_compact(Server* server) {
+    Phone_Registry* compacted = calloc(1, sizeof(Phone_Registry));
+    or_exit(compacted != NULL, ERROR_FILE_TOO_LARGE);
+    registry_compact(server->registry, OUT compacted);
+    _server_prepare(server->args, compacted);
+    _server_swap(server, compacted);
+    server->compaction_requested = 0;
+    print_error("[Server]: compacted %s (%lu items)\n", server->args->registry_path, (unsigned long)compacted->num_items);
+    return compacted->num_items;
+}
+
+/** @brief compacts the registry in the background whenever the edits leave enough garbage behind (see registry_needs_compaction) */
+static thread_routine(_server_compactor, arg) {
+    Server* server = (Server*)arg;
+    pthread_mutex_lock(&server->edits);
+    for (;;) {
+        while (!server->compaction_requested && !server->stopping) {
+            pthread_cond_wait(&server->compaction, &server->edits);
+        }
+        if (server->stopping) {
+            break;
+        }
+        _server_compact(server);
+    }
+    pthread_mutex_unlock(&server->edits);
+    return THREAD_ROUTINE_RETURN;
+}
+
+/** @brief applies the edit @param line (see edit_parse_command), !compact is answered once the compaction is done */
+static void _server_edit(Server* server, char* line, Output_Writer* writer) {
+    Edit_Command command;
+    Phone_Item_Index result = 0;
+    Error error = edit_parse_command(line, OUT &command);
+    if (error == ERROR_NONE) {
+        pthread_mutex_lock(&server->edits);
+        if (command.kind == EDIT_COMPACT) {
+            result = _server_compact(server);
+        } else {
+            _server_write_lock(server);
+            error = registry_edit(server->registry, &command, OUT &result);
+            _server_prepare(server->args, server->registry);
+            int needs_compaction = registry_needs_compaction(server->registry);
+            pthread_rwlock_unlock(&server->lock);
+            if (needs_compaction && !server->compaction_requested) {
+                server->compaction_requested = 1;
+                pthread_cond_signal(&server->compaction);
+            }
+        }
+        pthread_mutex_unlock(&server->edits);
+    }
+    if (error != ERROR_NONE) {
+        output_write(writer, SERVER_INVALID_QUERY "\n", sizeof(SERVER_INVALID_QUERY));
+        return;
+    }
+    edit_print_result(writer, result);
+}
+
+/**
+ * @brief formats the @param matches (the same as print_matches) into the @param out_answer, the registry has to be read locked
+ * @note the answer is written to the connection only once the lock is released, a client which does not read it cannot hold the lock
+ */
+static void _server_format(Phone_Registry* restrict registry, const Phone_Registry_View* restrict matches, OUT Arena* restrict out_answer) {
+    out_answer->size = 0;
+    if (matches->num_indexes == 0) {
+        size_t offset = arena_push(out_answer, sizeof(NOT_FOUND_MESSAGE) - 1);
+        memcpy(out_answer->memory + offset, NOT_FOUND_MESSAGE, sizeof(NOT_FOUND_MESSAGE) - 1);
+        return;
+    }
+    for (Phone_Item_Index i = 0; i < matches->num_indexes; i++) {
+        Phone_Item_Index index = view_index(matches, i);
+        const Phone_Item* item = registry_item(registry, index);
+        size_t offset = arena_push(out_answer, fields_line_size(item->name_size, item->number_size));
+        format_fields(out_answer->memory + offset, item_name(registry, index), item->name_size, item_number(registry, index), item->number_size);
+    }
+}
+
+/** @brief answers one request @param line (same form as a line of the batch) with a result block terminated by an empty line */
+static void _server_answer(Server* server, char* line, Sys_Args* query, Phone_Registry_View* matches, Arena* answer, Output_Writer* writer) {
+    if (edit_is_command(line)) {
+        _server_edit(server, line, writer);
+        return;
+    }
+    if (batch_parse_query(line, query) != ERROR_NONE) {
+        output_write(writer, SERVER_INVALID_QUERY "\n", sizeof(SERVER_INVALID_QUERY));
+        return;
+    }
+    view_clear(matches);
+    _server_read_lock(server);
+    // the stats cannot be enabled in the server (-m), and the registry is prepared already (see _server_prepare)
+    _registry_match(query, server->registry, matches);
+    _server_format(server->registry, matches, OUT answer);
+    pthread_rwlock_unlock(&server->lock);
+    for (size_t offset = 0; offset < answer->size; offset += OUTPUT_BUFFER_SIZE) {
+        size_t size = answer->size - offset < OUTPUT_BUFFER_SIZE ? answer->size - offset : OUTPUT_BUFFER_SIZE;
+        output_write(writer, answer->memory + offset, size);
+    }
+    output_write(writer, "\n", 1);
+}
+
+/**
+ * @brief answers the requests of the @param connection until it is closed
+ * @note all the complete lines read at once are answered with one write
+ */
+static void _server_serve(Server* server, int connection, Output_Writer* writer, Phone_Registry_View* matches, Arena* answer) {
+    Sys_Args query = *server->args;
+    // the workers are the parallelism of the server
+    query.num_threads = 1;
+    writer->fd = connection;
+    writer->failed = 0;
+    char buffer[SERVER_READ_SIZE + 1];
+    size_t size = 0;
+    for (;;) {
+        ssize_t num_read = read(connection, buffer + size, SERVER_READ_SIZE - size);
+        if (num_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (num_read <= 0) {
+            // the last request does not have to be terminated
+            if (size > 0) {
+                buffer[size] = '\0';
+                _server_answer(server, buffer, &query, matches, answer, writer);
+                output_flush(writer);
+            }
+            return;
+        }
+        size += (size_t)num_read;
+        char* line = buffer;
+        for (char* line_end; (line_end = memchr(line, '\n', (size_t)(buffer + size - line))) != NULL; line = line_end + 1) {
+            *line_end = '\0';
+            _server_answer(server, line, &query, matches, answer, writer);
+        }
+        size = (size_t)(buffer + size - line);
+        memmove(buffer, line, size);
+        if (size == SERVER_READ_SIZE) {
+            output_write(writer, SERVER_INVALID_QUERY "\n", sizeof(SERVER_INVALID_QUERY));
+            output_flush(writer);
+            return;
+        }
+        if (str_fail(output_flush(writer))) {
+            return;
+        }
+    }
+}
+
+static thread_routine(_server_worker, arg) {
+    Server_Worker* worker = (Server_Worker*)arg;
+    Server* server = worker->server;
+    Output_Writer* writer = calloc(1, sizeof(Output_Writer));
+    or_exit(writer != NULL, ERROR_FILE_TOO_LARGE);
+    writer->soft_errors = 1;
+    Phone_Registry_View matches = { 0 };
+    // the answer to the current request, see _server_format
+    Arena answer = { 0 };
+    for (;;) {
+        int connection = accept(server->listener, NULL, NULL);
+        if (connection < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // the listener was shut down
+            break;
+        }
+        if (str_fail(_server_connect(server, worker->slot, connection))) {
+            close(connection);
+            break;
+        }
+        _server_serve(server, connection, writer, &matches, &answer);
+        _server_disconnect(server, worker->slot);
+        close(connection);
+    }
+    arena_free(&answer);
+    arena_free(&matches.indexes);
+    free(writer);
+    return THREAD_ROUTINE_RETURN;
+}
+
+static int _server_listen(const char* path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    or_exit(strlen(path) < sizeof(address.sun_path), ERROR_SOCKET);
+    strcpy(address.sun_path, path);
+    // a socket left behind by a previous server is replaced, any other file is not
+    struct stat file_stat;
+    if (lstat(path, &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) {
+        unlink(path);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    or_exit(listener >= 0, ERROR_SOCKET);
+    or_exit(bind(listener, (struct sockaddr*)&address, sizeof(address)) == 0 && listen(listener, SERVER_BACKLOG) == 0, ERROR_SOCKET);
+    return listener;
+}
+
+/**
+ * @brief serves the registry file (-f) on the Unix domain socket (-u) until SIGINT or SIGTERM, SIGHUP reloads the registry
+ * @note the signals are blocked in every thread and waited for here, so the reload does not run inside of a signal handler
+ */
+static void run_server(const Sys_Args* args) {
+    static Server server = { 0 };
+    static Thread workers[THREADS_MAX_COUNT];
+    static Server_Worker worker_args[THREADS_MAX_COUNT];
+    Thread compactor;
+    server.args = args;
+    Error error = _server_load(args, OUT &server.registry);
+    or_exit(error == ERROR_NONE, error);
+    or_exit(pthread_rwlock_init(&server.lock, NULL) == 0 && pthread_mutex_init(&server.turnstile, NULL) == 0, ERROR_SOCKET);
+    or_exit(pthread_mutex_init(&server.edits, NULL) == 0 && pthread_cond_init(&server.compaction, NULL) == 0, ERROR_SOCKET);
+    or_exit(pthread_mutex_init(&server.connections_lock, NULL) == 0, ERROR_SOCKET);
+    server.listener = _server_listen(args->serve_path);
+    // the registry is edited (and swapped) by the workers once they are started
+    print_error("[Server]: serving %s (%lu items) on %s\n", args->registry_path, (unsigned long)server.registry->num_items, args->serve_path);
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+    // a client closing its connection early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    unsigned num_workers = args->num_threads > 0 ? args->num_threads : SERVER_DEFAULT_WORKERS;
+    for (unsigned w = 0; w < num_workers; w++) {
+        server.connections[w] = -1;
+        worker_args[w] = (Server_Worker){ .server = &server, .slot = w };
+        or_exit(str_success(thread_start(&workers[w], _server_worker, &worker_args[w])), ERROR_SOCKET);
+    }
+    or_exit(str_success(thread_start(&compactor, _server_compactor, &server)), ERROR_SOCKET);
+
+    for (;;) {
+        int received = 0;
+        if (sigwait(&signals, &received) != 0 || received != SIGHUP) {
+            break;
+        }
+        server_reload(&server);
+    }
+
+    shutdown(server.listener, SHUT_RDWR);
+    _server_close_connections(&server, num_workers);
+    for (unsigned w = 0; w < num_workers; w++) {
+        thread_join(workers[w]);
+    }
+    pthread_mutex_lock(&server.edits);
+    server.stopping = 1;
+    pthread_cond_signal(&server.compaction);
+    pthread_mutex_unlock(&server.edits);
+    thread_join(compactor);
+    close(server.listener);
+    unlink(args->serve_path);
+    pthread_cond_destroy(&server.compaction);
+    pthread_mutex_destroy(&server.edits);
+    pthread_mutex_destroy(&server.connections_lock);
+    pthread_mutex_destroy(&server.turnstile);
+    pthread_rwlock_destroy(&server.lock);
+    _server_unload(server.registry);
+}
+
+#else
+
+static void run_server(const Sys_Args* args) {
+    (void)args;
+    do_exit(ERROR_SOCKET);
+}
 
-    /* parse file */
-    parse_file_contents(&registry);
+#endif
+
+/* the benchmark (bench/bench.c) includes this file and runs the phases itself */
+#ifndef TNINE_NO_MAIN
+int main(int argc, char** argv) {
+    
+    /* the registry and the view only keep their arenas here, the items themselves live on the heap and are released all at once before exit */
+    static Sys_Args args = { 0 };
+    static Phone_Registry registry = { 0 };
+    static Phone_Registry_View matches = { 0 };
+
+    /* ensure the validity of sysargs */
+    args = validate_sys_args(argc, argv);
+    /* the stats are reported after the output is flushed (atexit runs in the reverse order) */
+    stats.enabled = (args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_STATS) > 0;
+    if (stats.enabled) {
+        atexit(stats_report);
+    }
+    output.interactive = is_stdout_terminal();
+    atexit(output_flush_at_exit);
+
+    if (args.serve_path != NULL) {
+        run_server(&args);
+        return ERROR_NONE;
+    }
+
+    if (args.num_shards > 1) {
+        run_shards(&args);
+        return ERROR_NONE;
+    }
+
+    FILE* input = stdin;
+    if (args.registry_path != NULL) {
+        input = fopen(args.registry_path, "rb");
+        or_exit(input != NULL, ERROR_FILE_OPEN);
+    } else if (!is_stdin_redirected()) {
+        printf("Input is not being redirected from a file. Was this your intention?\n");
+    }
+
+    if ((args.optionals & OPTIONAL_SYS_ARG_FOOTPRINT_STREAM) != 0) {
+        run_stream(&args, input);
+        if (input != stdin) {
+            fclose(input);
+        }
+        return ERROR_NONE;
+    }
+
+    /* read (or map) the whole input, then either load the compiled image from it or parse it as the text file */
+    Error error = registry_load(input, args.num_threads, 1, &registry);
+    or_exit(error == ERROR_NONE, error);
+    if (input != stdin) {
+        fclose(input);
+    }
+    uint64_t begin;
+
+    if (args.compile_path != NULL) {
+        begin = stats_begin();
+        image_compile(&registry, args.compile_path);
+        stats_end(STATS_PHASE_BUILD, begin);
+        registry_free(&registry);
+        return ERROR_NONE;
+    }
+
+    if (args.session_path != NULL) {
+        run_session(&args, &registry);
+        begin = stats_begin();
+        or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+        stats_end(STATS_PHASE_PRINT, begin);
+        registry_free(&registry);
+        return ERROR_NONE;
+    }
+
+    if (args.batch_path != NULL) {
+        run_batch(&args, &registry);
+        begin = stats_begin();
+        or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+        stats_end(STATS_PHASE_PRINT, begin);
+        registry_free(&registry);
+        return ERROR_NONE;
+    }
 
     /* scan for matches */
     registry_match(&args, &registry, &matches);
 
     /* print matches */
-    print_matches(&registry, &matches);
+    begin = stats_begin();
+    print_matches(&output, &registry, &matches);
+    or_exit(str_success(output_flush(&output)), ERROR_OUTPUT_WRITE);
+    stats_end(STATS_PHASE_PRINT, begin);
+
+    arena_free(&matches.indexes);
+    registry_free(&registry);
 
     return ERROR_NONE;
-}
\ No newline at end of file
+}
+#endif